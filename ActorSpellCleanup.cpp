@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "ActorSpellCleanup.h"
+#include "PruneRules.h"
+#include "SpellAccess.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct SpellEntry
+	{
+		uint32_t formID;
+		int32_t spellType;
+		uint8_t flags;
+		bool remove;
+	};
+
+	// Game pointers are only dereferenced on the game thread, the workers read the POD entries
+	struct Snapshot
+	{
+		std::vector<Actor*> actors;
+		std::vector<SpellItem*> spells;
+		std::vector<uint32_t> spellOwner;	// Index into actors, per spell
+		std::vector<SpellEntry> entries;	// Parallel to spells
+	};
+
+	double ElapsedMs(std::chrono::steady_clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+	}
+}
+
+ActorSpellCleanup::Report ActorSpellCleanup::Run(const PruneRules& rules, const std::unordered_set<uint32_t>& blacklist, bool includePlayer, PlayerRemoveFn removePlayerSpell)
+{
+	Report report;
+	Snapshot snapshot;
+	Actor* player = PlayerCharacter::GetSingleton();
+
+	// Phase 1: copy the spell lists
+	auto start = std::chrono::steady_clock::now();
+
+	SpellAccess::ForEachLoadedActor([&](Actor* actor) {
+		if (actor == player && !includePlayer) return;
+
+		const auto owner = static_cast<uint32_t>(snapshot.actors.size());
+		snapshot.actors.push_back(actor);
+
+		SpellAccess::ForEachSpell(actor, [&](SpellItem* spell) {
+			snapshot.spells.push_back(spell);
+			snapshot.spellOwner.push_back(owner);
+			snapshot.entries.push_back({ spell->iFormID, spell->data.iSpellType, spell->data.flags, false });
+			});
+		});
+
+	report.actors = snapshot.actors.size();
+	report.spellsScanned = snapshot.entries.size();
+	report.snapshotMs = ElapsedMs(start);
+
+	// Phase 2: find candidates in parallel. Workers write disjoint ranges of entries
+	start = std::chrono::steady_clock::now();
+
+	const size_t count = snapshot.entries.size();
+	const size_t workerCount = std::clamp<size_t>(count / 512, 1, std::max(1u, std::thread::hardware_concurrency()));
+	const size_t perWorker = (count + workerCount - 1) / workerCount;
+	std::vector<size_t> blacklistedPerWorker(workerCount, 0);
+
+	auto scan = [&](size_t worker) {
+		const size_t begin = worker * perWorker;
+		const size_t end = std::min(count, begin + perWorker);
+
+		for (size_t i = begin; i < end; ++i) {
+			SpellEntry& entry = snapshot.entries[i];
+			if (rules.Match(entry.formID, entry.spellType, entry.flags) == PruneRules::Action::None) continue;
+
+			if (blacklist.contains(entry.formID)) {
+				blacklistedPerWorker[worker]++;
+				continue;
+			}
+
+			entry.remove = true;
+		}
+		};
+
+	std::vector<std::thread> workers;
+	workers.reserve(workerCount - 1);
+	for (size_t worker = 1; worker < workerCount; ++worker)
+		workers.emplace_back(scan, worker);
+	scan(0);
+	for (auto& worker : workers)
+		worker.join();
+
+	for (const size_t blacklisted : blacklistedPerWorker)
+		report.blacklisted += blacklisted;
+	report.scanMs = ElapsedMs(start);
+
+	// Phase 3: apply on the game thread. Actors sharing a base form share the list, so later removals may fail.
+	// The player's spells go through the journaled delete so they can be undone
+	start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < count; ++i) {
+		if (!snapshot.entries[i].remove) continue;
+
+		report.candidates++;
+		Actor* actor = snapshot.actors[snapshot.spellOwner[i]];
+		SpellItem* spell = snapshot.spells[i];
+
+		const bool removed = actor == player ? removePlayerSpell(spell) : actor->RemoveSpell(spell);
+		if (removed)
+			report.removed++;
+	}
+
+	report.applyMs = ElapsedMs(start);
+	return report;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+
+class PruneRules;
+class SpellItem;
+
+// Removes spells matching a rule set from every loaded actor.
+// Runs in three phases: the actors' spell lists are copied on the game thread, the copy is
+// scanned for candidates in parallel without touching game memory, and the removals are
+// applied on the game thread in one batch.
+class ActorSpellCleanup
+{
+public:
+	struct Report
+	{
+		size_t actors = 0;
+		size_t spellsScanned = 0;
+		size_t candidates = 0;
+		size_t blacklisted = 0;
+		size_t removed = 0;
+		double snapshotMs = 0;
+		double scanMs = 0;
+		double applyMs = 0;
+	};
+
+	// Removes a spell from the player through the plugin's journaled delete, returns true if it was removed
+	using PlayerRemoveFn = bool(*)(SpellItem* spell);
+
+	// Game thread only. Blacklisted spells are never removed
+	static Report Run(const PruneRules& rules, const std::unordered_set<uint32_t>& blacklist, bool includePlayer, PlayerRemoveFn removePlayerSpell);
+};
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "Commands.h"
+#include "ConfigFile.h"
+#include "DeletionScheduler.h"
+#include "PluginAPI.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	struct CommandEntry
+	{
+		const char* name = nullptr;
+		CommandHandler handler = nullptr;
+		int hotkey = 0;
+	};
+
+	constexpr size_t kCommandCount = static_cast<size_t>(Command::Count);
+
+	CommandEntry g_Commands[kCommandCount];
+	std::atomic<uint32_t> g_Pending{ 0 };
+	std::atomic<uint32_t> g_Arguments[kCommandCount];
+	uint32_t g_RunningArguments[kCommandCount] = {};
+	int g_ModifierKey = 0;
+
+	OBSEMessagingInterface* g_Messaging = nullptr;
+	uint32_t g_PluginHandle = 0;
+
+	CommandEntry* Find(Command command)
+	{
+		const auto index = static_cast<size_t>(command);
+		if (index == 0 || index >= kCommandCount) return nullptr;
+		return &g_Commands[index];
+	}
+
+	void OnMessage(OBSEMessagingInterface::Message* msg)
+	{
+		if (!msg || !msg->sender) return;
+
+		// Messages from OBSE itself share the type range with ours
+		if (strcmp(msg->sender, "OBSE") == 0) return;
+
+		if (msg->type == kMessage_DeleteSpells) {
+			if (!msg->data || msg->dataLen % sizeof(uint32_t)) return;
+
+			const size_t count = msg->dataLen / sizeof(uint32_t);
+			printf("[Delete Spells] Received %zu deletions from %s\n", count, msg->sender);
+			DeletionScheduler::Enqueue({ static_cast<const uint32_t*>(msg->data), count });
+			return;
+		}
+
+		const auto command = static_cast<Command>(msg->type);
+		if (!Find(command)) return;
+
+		uint32_t argument = 0;
+		if (msg->data && msg->dataLen == sizeof(uint32_t))
+			memcpy(&argument, msg->data, sizeof(argument));
+
+		printf("[Delete Spells] Received command %u (argument %u) from %s\n", msg->type, argument, msg->sender);
+		Commands::Queue(command, argument);
+	}
+
+	// Listening to every plugin only covers the ones already loaded, so it waits until all are
+	void OnObseMessage(OBSEMessagingInterface::Message* msg)
+	{
+		if (!msg || msg->type != OBSEMessagingInterface::kMessage_PostLoad) return;
+
+		if (!g_Messaging->RegisterListener(g_PluginHandle, nullptr, OnMessage)) {
+			printf("[Delete Spells] Failed to register command message listener\n");
+		}
+	}
+}
+
+void Commands::Register(Command command, const char* name, const char* hotkeyConfigKey, CommandHandler handler)
+{
+	auto* entry = Find(command);
+	if (!entry) return;
+
+	entry->name = name;
+	entry->handler = handler;
+	entry->hotkey = hotkeyConfigKey ? ConfigFile::GetInt(hotkeyConfigKey, 0) : 0;
+}
+
+void Commands::Init(OBSEMessagingInterface* messaging, uint32_t pluginHandle)
+{
+	g_ModifierKey = ConfigFile::GetInt("iCommandModifierKey", VK_RCONTROL);
+
+	if (messaging) {
+		g_Messaging = messaging;
+		g_PluginHandle = pluginHandle;
+
+		if (!messaging->RegisterListener(pluginHandle, "OBSE", OnObseMessage)) {
+			printf("[Delete Spells] Failed to register OBSE message listener\n");
+		}
+	}
+
+	const bool anyHotkey = std::ranges::any_of(g_Commands, [](const CommandEntry& e) { return e.handler && e.hotkey; });
+	if (anyHotkey) {
+		std::thread(PollHotkeys).detach();
+	}
+}
+
+void Commands::Queue(Command command, uint32_t argument)
+{
+	auto* entry = Find(command);
+	if (!entry || !entry->handler) return;
+
+	// Stored before the pending bit, so RunPending never sees the bit without it
+	g_Arguments[static_cast<size_t>(command)].store(argument, std::memory_order_release);
+
+	const uint32_t bit = 1u << static_cast<uint32_t>(command);
+	if (!(g_Pending.fetch_or(bit, std::memory_order_acq_rel) & bit)) {
+		printf("[Delete Spells] Queued command: %s (runs at the next safe point)\n", entry->name);
+	}
+}
+
+void Commands::RunPending()
+{
+	uint32_t pending = g_Pending.exchange(0, std::memory_order_acq_rel);
+	if (!pending) return;
+
+	for (size_t i = 1; i < kCommandCount; ++i) {
+		if (!(pending & (1u << i))) continue;
+
+		const auto& entry = g_Commands[i];
+		if (!entry.handler) continue;
+
+		g_RunningArguments[i] = g_Arguments[i].exchange(0, std::memory_order_acquire);
+
+		printf("[Delete Spells] Running command: %s\n", entry.name);
+		entry.handler();
+	}
+}
+
+uint32_t Commands::GetArgument(Command command)
+{
+	const auto index = static_cast<size_t>(command);
+	return index < kCommandCount ? g_RunningArguments[index] : 0;
+}
+
+// Hotkeys are edge triggered and require the command modifier key, so they do not
+// clash with the regular game bindings
+void Commands::PollHotkeys()
+{
+	bool wasDown[kCommandCount] = {};
+
+	while (true) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		const bool modifierHeld = (GetAsyncKeyState(g_ModifierKey) & 0x8000) != 0;
+
+		for (size_t i = 1; i < kCommandCount; ++i) {
+			const auto& entry = g_Commands[i];
+			if (!entry.handler || !entry.hotkey) continue;
+
+			const bool down = modifierHeld && (GetAsyncKeyState(entry.hotkey) & 0x8000);
+			if (down && !wasDown[i]) {
+				Queue(static_cast<Command>(i));
+			}
+			wasDown[i] = down;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+struct OBSEMessagingInterface;
+
+// Commands that can be triggered by hotkey or by another plugin through the OBSE messaging interface.
+// The value is the message type other plugins dispatch to "Delete Spells". A message may carry a
+// uint32_t argument, e.g. the number of deletions for UndoDeletions.
+enum class Command : uint32_t
+{
+	CleanupUnusedSpells = 1,
+	DeleteDuplicateSpells,
+	ApplyAutoPrune,
+	UndoDeletions,
+	ExportSpells,
+	RemoveActorSpells,
+	CancelDeletions,
+	ProfileSpells,
+	Count
+};
+
+// Message type other plugins dispatch to queue spell deletions. The data is an array of uint32_t FormIDs
+constexpr uint32_t kMessage_DeleteSpells = 0x100;
+
+using CommandHandler = void(*)();
+
+// Commands are queued from any thread and run on the game thread at the next safe point,
+// the Magic menu list rebuild.
+class Commands
+{
+public:
+	// hotkeyConfigKey names the config entry holding the virtual key code (0 disables the hotkey)
+	static void Register(Command command, const char* name, const char* hotkeyConfigKey, CommandHandler handler);
+
+	// Starts the hotkey poller and, for OBSE builds, listens for command messages once all plugins are loaded
+	static void Init(OBSEMessagingInterface* messaging, uint32_t pluginHandle);
+
+	// Thread safe, lock free. A pending command keeps the latest argument
+	static void Queue(Command command, uint32_t argument = 0);
+
+	// Argument the command was queued with, 0 if none. Read by the handler while it runs
+	static uint32_t GetArgument(Command command);
+
+	// Game thread only
+	static void RunPending();
+
+private:
+	static void PollHotkeys();
+};
@@ -4,7 +4,9 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 #include <cctype>
 #include <cstdio>
 
@@ -21,6 +23,17 @@ void ConfigFile::Init()
 	GetInstance().InitImpl();
 }
 
+bool ConfigFile::InitFromFile(const std::string& path)
+{
+	auto& self = GetInstance();
+	if (self.m_Initialized || !std::filesystem::exists(path)) return false;
+	self.m_Initialized = true;
+
+	self.m_ConfigDirectory = std::filesystem::path(path).parent_path().string();
+	self.LoadFromFile(path);
+	return true;
+}
+
 bool ConfigFile::GetBool(std::string_view key, bool defaultValue)
 {
 	auto& self = GetInstance();
@@ -76,6 +89,26 @@ float ConfigFile::GetFloat(std::string_view key, float defaultValue)
 	return parsed ? result : defaultValue;
 }
 
+std::string ConfigFile::GetString(std::string_view key, std::string_view defaultValue)
+{
+	auto& self = GetInstance();
+	if (!self.m_Initialized) self.InitImpl();
+
+	auto it = self.m_Variables.find(std::string(key));
+	if (it == self.m_Variables.end()) return std::string(defaultValue);
+
+	std::string result = self.Trim(it->second);
+	LogReadResult<std::string>(std::string(key), result, std::string(defaultValue));
+	return result;
+}
+
+const std::string& ConfigFile::GetConfigDirectory()
+{
+	auto& self = GetInstance();
+	if (!self.m_Initialized) self.InitImpl();
+	return self.m_ConfigDirectory;
+}
+
 const std::unordered_set<uint32_t>& ConfigFile::GetBlacklistedSpells()
 {
 	auto& self = GetInstance();
@@ -83,16 +116,28 @@ const std::unordered_set<uint32_t>& ConfigFile::GetBlacklistedSpells()
 	return self.m_BlacklistedFormIDs;
 }
 
+const std::vector<std::string>& ConfigFile::GetArray(std::string_view name)
+{
+	static const std::vector<std::string> empty;
+
+	auto& self = GetInstance();
+	if (!self.m_Initialized) self.InitImpl();
+
+	auto it = self.m_Arrays.find(std::string(name));
+	return it != self.m_Arrays.end() ? it->second : empty;
+}
+
 void ConfigFile::InitImpl()
 {
 	if (m_Initialized) return;
 	m_Initialized = true;
 
 #ifdef ASI
-	const string fullPath = GetPluginDirectory() + "\\DeleteSpells.conf";
+	m_ConfigDirectory = GetPluginDirectory();
 #else
-	const string fullPath = GetPluginDirectory() + "\\OBSE\\Plugins\\DeleteSpells.conf";
+	m_ConfigDirectory = GetPluginDirectory() + "\\OBSE\\Plugins";
 #endif
+	const string fullPath = m_ConfigDirectory + "\\DeleteSpells.conf";
 
 	LoadFromFile(fullPath);
 }
@@ -151,6 +196,9 @@ void ConfigFile::LoadFromFile(const std::string& fullPath)
 					printf("[Delete Spells] Invalid FormID at line %zu: %s\n", lineNum, line.c_str());
 				}
 			}
+			else {
+				m_Arrays[currentArrayName].push_back(line);
+			}
 			continue;
 		}
 
@@ -179,6 +227,7 @@ bool ConfigFile::GenerateDefault(const string& path)
 	out << "bProtectSpells = true ; If true, spells in the blacklist will not be deleted\n";
 	out << "bUseTranslationFile = true ; If true, uses translated confirmation string from Magic Loader 2 json file, otherwise uses hardcoded English version\n";
 	out << "bSpellInfoLog = false ; If true, spell information will be logged to the console\n";
+	out << "bUseXrefIndex = false ; If true, call targets are resolved from a cached index of the game's calls and data references\n";
 	out << "\n";
 	out << "; === Keyboard ===\n";
 	out << "; Valid modifier keys: 0xA0 (VK_LSHIFT), 0xA1 (VK_RSHIFT), 0xA2 (VK_LCONTROL), 0xA3 (VK_RCONTROL), 0xA4 (VK_LMENU), 0xA5 (VK_RMENU)\n";
@@ -189,6 +238,50 @@ bool ConfigFile::GenerateDefault(const string& path)
 	out << "iGamepadDeleteButton = 0x1000 ; Default is XINPUT_GAMEPAD_A\n";
 	out << "iGamepadModifierButton = 0x0020 ; Default is XINPUT_GAMEPAD_BACK\n";
 	out << "\n";
+	out << "; === Commands ===\n";
+	out << "; Command hotkeys are pressed together with the modifier and run at the next safe point. 0 disables a hotkey\n";
+	out << "iCommandModifierKey = 0xA3 ; Default is VK_RCONTROL\n";
+	out << "iCleanupUnusedKey = 0 ; Deletes spells of sUnusedSpellTypes not cast for iUnusedSpellHours hours of play\n";
+	out << "iDeleteDuplicatesKey = 0 ; Deletes created spells with the same effects as another created spell, keeping the most used one\n";
+	out << "iUndoKey = 0 ; Re-adds the last iUndoCount deleted spells\n";
+	out << "iExportKey = 0 ; Writes the player's spell list to DeleteSpells\\<profile>_spells.csv or .jsonl\n";
+	out << "sExportFormat = csv ; csv or jsonl\n";
+	out << "iActorCleanupKey = 0 ; Removes spells matching ActorRemovalRules from every loaded actor\n";
+	out << "iCancelDeletionsKey = 0 ; Cancels queued deletions that have not run yet\n";
+	out << "iProfileKey = 0 ; Logs the player's spells ranked by memory footprint, and the Magic menu rebuild time while it is open\n";
+	out << "iProfileTopSpells = 20 ; Number of individual spells listed by the profiler\n";
+	out << "\n";
+	out << "; === Deletion scheduler ===\n";
+	out << "fDeletionBudgetMs = 0.5 ; Time spent removing queued spells each time the Magic menu opens or refreshes, the rest waits for the next refresh\n";
+	out << "\n";
+	out << "; === Deletion journal ===\n";
+	out << "bDeletionJournal = true ; If true, deletions are journaled so they can be undone\n";
+	out << "iUndoCount = 1 ; Number of deletions the undo command restores. Plugins sending UndoDeletions (message type 4) can pass a uint32_t count instead\n";
+	out << "iJournalFlushDelay = 250 ; Milliseconds to batch journal writes before flushing them to disk\n";
+	out << "\n";
+	out << "; === Spell usage ===\n";
+	out << "sSaveProfile = Default ; Name of the data files for this playthrough\n";
+	out << "; Usage is kept per sSaveProfile, not per save game. Casts since the last stats save are lost when the game exits\n";
+	out << "sCastSpellSignature = ; Signature of MagicCaster::CastSpell(MagicCaster*, SpellItem*, bool, MagicTarget*, float, bool). None ships yet, usage tracking and the cleanup command are disabled while empty\n";
+	out << "iUnusedSpellHours = 20 ; Spells not cast for this many hours of play are removed by the cleanup command. Play time is counted while the game runs, menus and pauses included\n";
+	out << "sUnusedSpellTypes = spell|power|lesserpower ; Spell types the cleanup command considers. Abilities and diseases are never cast, leave them out\n";
+	out << "iSpellStatsSaveInterval = 60 ; Seconds between usage stats saves\n";
+	out << "iSpellStatsCapacity = 4096 ; Maximum number of tracked spells\n";
+	out << "\n";
+	out << "; === Auto prune ===\n";
+	out << "; Checks spells added to the player against the rules below, first match wins. Blacklisted spells are never pruned\n";
+	out << "sAddSpellSignature = ; Signature of Actor::AddSpell(Actor*, SpellItem*) returning bool. None ships yet, auto prune does nothing while empty\n";
+	out << "; Rule keys: formid=0x01000000-0x0100FFFF, mod=0x0A, type=spell|disease|power|lesserpower|ability|poison, flags=0x04 (all bits set), action=reject|queue\n";
+	out << "; reject stops the spell from being added, queue lets it be added and removes it on the next Magic menu refresh\n";
+	out << "AutoPruneRules = {\n";
+	out << "}\n";
+	out << "\n";
+	out << "; === Actor cleanup ===\n";
+	out << "bActorCleanupIncludePlayer = false ; If true, the actor cleanup command also removes matching spells from the player\n";
+	out << "; Same rule keys as AutoPruneRules, any matching rule removes the spell. Blacklisted spells are never removed\n";
+	out << "ActorRemovalRules = {\n";
+	out << "}\n";
+	out << "\n";
 	out << "; === Blacklist ===\n";
 	out << "BlacklistedSpells = {\n";
 	out << "    0x00000136 ; Heal Minor Wounds\n";
@@ -219,10 +312,14 @@ std::string ConfigFile::Trim(const std::string& str)
 
 std::string ConfigFile::GetPluginDirectory()
 {
+#ifdef _WIN32
 	HMODULE hModule = nullptr;
 	GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, nullptr, &hModule);
 
 	char path[MAX_PATH] = {};
 	GetModuleFileNameA(hModule, path, MAX_PATH);
 	return std::filesystem::path(path).parent_path().string();
+#else
+	return std::filesystem::current_path().string();
+#endif
 }
\ No newline at end of file
@@ -3,20 +3,33 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <string_view>
 #include <cstdint>
+#include <cstdio>
 #include <optional>
 
 class ConfigFile
 {
 public:
 	static void Init(); // ручной вызов, если нужно
+
+	// Loads the given config instead of the plugin's, for tools running outside the game.
+	// Returns false if the file does not exist, no default is generated
+	static bool InitFromFile(const std::string& path);
 	static bool GetBool(std::string_view key, bool defaultValue = false);
 	static int GetInt(std::string_view key, int defaultValue = 0);
 	static float GetFloat(std::string_view key, float defaultValue = 0.0f);
+	static std::string GetString(std::string_view key, std::string_view defaultValue = {});
+
+	// Directory holding DeleteSpells.conf, also used for the plugin's data files
+	static const std::string& GetConfigDirectory();
 
 	static const std::unordered_set<uint32_t>& GetBlacklistedSpells();
 
+	// Raw entries of a `Name = { ... }` block, comments and whitespace stripped
+	static const std::vector<std::string>& GetArray(std::string_view name);
+
 private:
 	static ConfigFile& GetInstance();
 
@@ -33,6 +46,8 @@ private:
 		auto toString = [](const T& v) -> std::string {
 			if constexpr (std::is_same_v<T, bool>)
 				return v ? "true" : "false";
+			else if constexpr (std::is_same_v<T, std::string>)
+				return v;
 			else
 				return std::to_string(v);
 			};
@@ -47,6 +62,8 @@ private:
 
 private:
 	bool m_Initialized = false;
+	std::string m_ConfigDirectory;
 	std::unordered_map<std::string, std::string> m_Variables;
 	std::unordered_set<uint32_t> m_BlacklistedFormIDs;
+	std::unordered_map<std::string, std::vector<std::string>> m_Arrays;
 };
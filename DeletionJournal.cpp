@@ -0,0 +1,228 @@
+#include "pch.h"
+#include "DeletionJournal.h"
+#include "ConfigFile.h"
+#include "SaveProfile.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <io.h>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace
+{
+	enum RecordType : uint16_t
+	{
+		kRecord_Deleted = 1,
+		kRecord_Restored = 2,
+	};
+
+	constexpr uint16_t kVersion = 1;
+
+	struct Record
+	{
+		uint32_t formID;
+		uint16_t type;
+		uint16_t version;
+		int64_t timestamp;	// Unix time, seconds
+		uint64_t saveID;	// SaveProfile::GetId()
+		uint32_t sequence;
+		uint32_t checksum;	// CRC-32 of the preceding fields
+	};
+	static_assert(sizeof(Record) == 32, "Journal records must keep their on-disk size");
+
+	constexpr std::array<uint32_t, 256> kCrcTable = [] {
+		std::array<uint32_t, 256> table{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+		return table;
+		}();
+
+	uint32_t Checksum(const Record& record)
+	{
+		const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < offsetof(Record, checksum); ++i)
+			crc = kCrcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+}
+
+static std::mutex s_Mutex;
+static std::condition_variable s_WriterCv;
+static std::vector<Record> s_Pending;
+static std::vector<uint32_t> s_Undoable;	// Deletions of this profile not undone yet, oldest first
+static uint32_t s_Sequence = 0;
+static std::string s_Path;
+static bool s_Initialized = false;
+
+void DeletionJournal::Init()
+{
+	if (s_Initialized) return;
+	s_Initialized = true;
+
+	s_Path = SaveProfile::GetDataDirectory() + "\\DeletionJournal.bin";
+	Load();
+
+	std::thread(WriterThread).detach();
+}
+
+void DeletionJournal::Load()
+{
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(s_Path, ec);
+	if (ec) return;
+
+	// A crash during a write can leave a partial record at the end; cut it so appends stay aligned
+	if (size % sizeof(Record)) {
+		printf("[Delete Spells] Journal has a partial record, truncating\n");
+		std::filesystem::resize_file(s_Path, size - size % sizeof(Record), ec);
+	}
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, s_Path.c_str(), "rb") != 0 || !file) {
+		printf("[Delete Spells] Failed to open journal: %s\n", s_Path.c_str());
+		return;
+	}
+
+	const uint64_t saveID = SaveProfile::GetId();
+	size_t valid = 0;
+	size_t corrupt = 0;
+	Record record{};
+
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		if (record.checksum != Checksum(record) || record.version != kVersion) {
+			corrupt++;
+			continue;
+		}
+
+		valid++;
+		s_Sequence = std::max(s_Sequence, record.sequence + 1);
+		if (record.saveID != saveID) continue;
+
+		if (record.type == kRecord_Deleted) {
+			s_Undoable.push_back(record.formID);
+		}
+		else if (record.type == kRecord_Restored) {
+			const auto it = std::find(s_Undoable.rbegin(), s_Undoable.rend(), record.formID);
+			if (it != s_Undoable.rend())
+				s_Undoable.erase(std::next(it).base());
+		}
+	}
+
+	fclose(file);
+	printf("[Delete Spells] Journal loaded: %zu records, %zu corrupt skipped, %zu undoable\n", valid, corrupt, s_Undoable.size());
+}
+
+void DeletionJournal::Append(uint32_t formID, uint16_t type)
+{
+	Record record{};
+	record.formID = formID;
+	record.type = type;
+	record.version = kVersion;
+	record.timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	record.saveID = SaveProfile::GetId();
+
+	{
+		std::lock_guard lock(s_Mutex);
+		record.sequence = s_Sequence++;
+		record.checksum = Checksum(record);
+		s_Pending.push_back(record);
+	}
+	s_WriterCv.notify_one();
+}
+
+void DeletionJournal::RecordDeletion(uint32_t formID)
+{
+	if (!s_Initialized) return;
+
+	Append(formID, kRecord_Deleted);
+
+	std::lock_guard lock(s_Mutex);
+	s_Undoable.push_back(formID);
+}
+
+std::vector<uint32_t> DeletionJournal::TakeUndo(size_t count)
+{
+	std::vector<uint32_t> formIDs;
+	if (!s_Initialized) return formIDs;
+
+	{
+		std::lock_guard lock(s_Mutex);
+		count = std::min(count, s_Undoable.size());
+		formIDs.assign(s_Undoable.rbegin(), s_Undoable.rbegin() + count);
+		s_Undoable.resize(s_Undoable.size() - count);
+	}
+
+	return formIDs;
+}
+
+void DeletionJournal::RecordRestore(uint32_t formID)
+{
+	if (!s_Initialized) return;
+
+	Append(formID, kRecord_Restored);
+}
+
+void DeletionJournal::ReturnUndo(std::span<const uint32_t> formIDs)
+{
+	if (!s_Initialized || formIDs.empty()) return;
+
+	std::lock_guard lock(s_Mutex);
+	s_Undoable.insert(s_Undoable.end(), formIDs.rbegin(), formIDs.rend());
+}
+
+size_t DeletionJournal::GetUndoableCount()
+{
+	std::lock_guard lock(s_Mutex);
+	return s_Undoable.size();
+}
+
+// Waits a short window after the first pending record so bursts of deletions share one flush
+void DeletionJournal::WriterThread()
+{
+	const auto batchWindow = std::chrono::milliseconds(std::max(ConfigFile::GetInt("iJournalFlushDelay", 250), 0));
+	std::vector<Record> batch;
+
+	while (true) {
+		{
+			std::unique_lock lock(s_Mutex);
+			s_WriterCv.wait(lock, [] { return !s_Pending.empty(); });
+		}
+
+		std::this_thread::sleep_for(batchWindow);
+
+		{
+			std::lock_guard lock(s_Mutex);
+			batch.swap(s_Pending);
+		}
+
+		FILE* file = nullptr;
+		if (fopen_s(&file, s_Path.c_str(), "ab") != 0 || !file) {
+			printf("[Delete Spells] Failed to open journal, %zu records lost\n", batch.size());
+			batch.clear();
+			continue;
+		}
+
+		const size_t written = fwrite(batch.data(), sizeof(Record), batch.size(), file);
+		fflush(file);
+		_commit(_fileno(file));
+		fclose(file);
+
+		if (written != batch.size()) {
+			printf("[Delete Spells] Journal write failed, %zu of %zu records written\n", written, batch.size());
+		}
+
+		batch.clear();
+	}
+}
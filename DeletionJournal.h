@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Append-only log of deleted spells, used to undo deletions.
+// Records have a fixed size and carry their own checksum, so a record torn by a crash is
+// detected and skipped on load. Appends only queue the record; a background thread
+// writes and flushes batches so the game thread never waits on the disk.
+class DeletionJournal
+{
+public:
+	static void Init();
+
+	static void RecordDeletion(uint32_t formID);
+
+	// Takes the last `count` deletions of the current save profile that were not undone yet,
+	// newest first. Each one must then be passed to either RecordRestore or ReturnUndo
+	static std::vector<uint32_t> TakeUndo(size_t count);
+
+	// Journals a taken deletion as undone, call once the spell is back
+	static void RecordRestore(uint32_t formID);
+
+	// Puts taken deletions that could not be restored back on the undo stack, in the order TakeUndo returned them
+	static void ReturnUndo(std::span<const uint32_t> formIDs);
+
+	static size_t GetUndoableCount();
+
+private:
+	static void Append(uint32_t formID, uint16_t type);
+	static void Load();
+	static void WriterThread();
+};
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "DeletionScheduler.h"
+#include "ConfigFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Items taken from the queue per lock, re-queued at the front if the budget runs out
+	constexpr size_t kBatchSize = 32;
+
+	// Totals for the batch currently being drained, logged when the queue empties
+	struct BatchStats
+	{
+		size_t removed = 0;
+		size_t dropped = 0;
+		size_t drains = 0;
+		double totalMs = 0;
+		double maxMs = 0;
+	};
+}
+
+static std::mutex s_Mutex;
+static std::deque<uint32_t> s_Queue;
+static DeletionScheduler::RemoveFn s_Remove = nullptr;
+static Clock::duration s_Budget = std::chrono::microseconds(500);
+static BatchStats s_Stats;
+
+void DeletionScheduler::Init(RemoveFn remove)
+{
+	s_Remove = remove;
+
+	const float budgetMs = std::max(ConfigFile::GetFloat("fDeletionBudgetMs", 0.5f), 0.05f);
+	s_Budget = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(budgetMs));
+}
+
+void DeletionScheduler::Enqueue(uint32_t formID)
+{
+	std::lock_guard lock(s_Mutex);
+	s_Queue.push_back(formID);
+}
+
+void DeletionScheduler::Enqueue(std::span<const uint32_t> formIDs)
+{
+	std::lock_guard lock(s_Mutex);
+	s_Queue.insert(s_Queue.end(), formIDs.begin(), formIDs.end());
+}
+
+void DeletionScheduler::Cancel()
+{
+	size_t cancelled = 0;
+	{
+		std::lock_guard lock(s_Mutex);
+		cancelled = s_Queue.size();
+		s_Queue.clear();
+	}
+
+	printf("[Delete Spells] Cancelled %zu queued deletions\n", cancelled);
+}
+
+size_t DeletionScheduler::GetPendingCount()
+{
+	std::lock_guard lock(s_Mutex);
+	return s_Queue.size();
+}
+
+void DeletionScheduler::Drain()
+{
+	if (!s_Remove) return;
+
+	const auto start = Clock::now();
+	const auto deadline = start + s_Budget;
+	auto outOfBudget = [&] { return Clock::now() >= deadline; };
+
+	size_t removed = 0;
+	bool queueEmpty = false;
+	uint32_t batch[kBatchSize];
+
+	while (!queueEmpty) {
+		size_t taken = 0;
+		{
+			std::lock_guard lock(s_Mutex);
+			while (taken < kBatchSize && !s_Queue.empty()) {
+				batch[taken++] = s_Queue.front();
+				s_Queue.pop_front();
+			}
+			queueEmpty = s_Queue.empty();
+		}
+
+		if (!taken) break;
+
+		size_t processed = 0;
+		while (processed < taken) {
+			if (s_Remove(batch[processed++]))
+				removed++;
+			else
+				s_Stats.dropped++;
+
+			if (outOfBudget()) break;
+		}
+
+		// Out of budget: put the rest back in order and continue at the next drain
+		if (processed < taken) {
+			std::lock_guard lock(s_Mutex);
+			s_Queue.insert(s_Queue.begin(), batch + processed, batch + taken);
+			queueEmpty = false;
+			break;
+		}
+
+		if (outOfBudget()) break;
+	}
+
+	if (!removed && !s_Stats.dropped && !s_Stats.drains) return;
+
+	const double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	s_Stats.removed += removed;
+	s_Stats.drains++;
+	s_Stats.totalMs += elapsedMs;
+	s_Stats.maxMs = std::max(s_Stats.maxMs, elapsedMs);
+
+	if (!queueEmpty) {
+		printf("[Delete Spells] %zu deletions left for the next Magic menu refresh\n", GetPendingCount());
+		return;
+	}
+
+	printf("[Delete Spells] Deleted %zu spells (%zu stale dropped) over %zu refreshes | avg %.3f ms, max %.3f ms per refresh (budget %.3f ms)\n",
+		s_Stats.removed,
+		s_Stats.dropped,
+		s_Stats.drains,
+		s_Stats.totalMs / s_Stats.drains,
+		s_Stats.maxMs,
+		std::chrono::duration<double, std::milli>(s_Budget).count()
+	);
+	s_Stats = {};
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Queue of spell FormIDs waiting to be removed from the player.
+// Drain runs on the game thread right before the Magic menu list rebuild and stops once the budget
+// (fDeletionBudgetMs) is used. What is left carries over to the next rebuild, so large batches are
+// spread over several menu refreshes instead of stalling one. IDs that no longer resolve to a spell
+// the player has are dropped. The rebuild that follows the drain is the only menu refresh.
+class DeletionScheduler
+{
+public:
+	// Returns true if the spell was removed, false if it is stale or protected
+	using RemoveFn = bool(*)(uint32_t formID);
+
+	static void Init(RemoveFn remove);
+
+	// Thread safe
+	static void Enqueue(uint32_t formID);
+	static void Enqueue(std::span<const uint32_t> formIDs);
+	static void Cancel();
+	static size_t GetPendingCount();
+
+	// Game thread only, before the Magic menu list is rebuilt
+	static void Drain();
+};
@@ -0,0 +1,197 @@
+#include "pch.h"
+#include "ModuleXrefs.h"
+#include "SaveProfile.h"
+#include "XrefIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Section
+	{
+		uint32_t rva = 0;
+		uint32_t size = 0;
+	};
+
+	XrefIndex g_Index;
+	uintptr_t g_Base = 0;
+	Section g_Text;
+	std::vector<Section> g_DataSections;
+	std::span<const RUNTIME_FUNCTION> g_Functions;
+
+	std::span<const uint8_t> View(const Section& section)
+	{
+		return { reinterpret_cast<const uint8_t*>(g_Base + section.rva), section.size };
+	}
+
+	bool ParseImage()
+	{
+		g_Base = reinterpret_cast<uintptr_t>(GetModuleHandleA(nullptr));
+		const auto* dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(g_Base);
+		if (dos->e_magic != IMAGE_DOS_SIGNATURE) return false;
+
+		const auto* nt = reinterpret_cast<const IMAGE_NT_HEADERS64*>(g_Base + dos->e_lfanew);
+		if (nt->Signature != IMAGE_NT_SIGNATURE) return false;
+
+		const auto* section = IMAGE_FIRST_SECTION(nt);
+		for (WORD i = 0; i < nt->FileHeader.NumberOfSections; ++i, ++section) {
+			const Section entry{ static_cast<uint32_t>(section->VirtualAddress), static_cast<uint32_t>(section->Misc.VirtualSize) };
+			const std::string_view name(reinterpret_cast<const char*>(section->Name), strnlen(reinterpret_cast<const char*>(section->Name), 8));
+
+			if (name == ".text")
+				g_Text = entry;
+			else if (name == ".rdata" || name == ".data")
+				g_DataSections.push_back(entry);
+		}
+
+		const auto& exceptions = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXCEPTION];
+		g_Functions = {
+			reinterpret_cast<const RUNTIME_FUNCTION*>(g_Base + exceptions.VirtualAddress),
+			exceptions.Size / sizeof(RUNTIME_FUNCTION)
+		};
+
+		return g_Text.size != 0;
+	}
+
+	// Changes whenever the executable is patched, which invalidates the cached index
+	uint64_t GetCacheKey()
+	{
+		const auto* dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(g_Base);
+		const auto* nt = reinterpret_cast<const IMAGE_NT_HEADERS64*>(g_Base + dos->e_lfanew);
+		return (static_cast<uint64_t>(nt->FileHeader.TimeDateStamp) << 32) ^ nt->OptionalHeader.SizeOfImage ^ (static_cast<uint64_t>(g_Text.size) << 8);
+	}
+}
+
+bool ModuleXrefs::Init(unsigned threads)
+{
+	if (!g_Index.IsEmpty()) return true;
+
+	if (!ParseImage()) {
+		printf("[Delete Spells] Failed to parse the game executable, xref index disabled\n");
+		return false;
+	}
+
+	const std::string cachePath = SaveProfile::GetDataDirectory() + "\\XrefIndex.bin";
+	const uint64_t key = GetCacheKey();
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, cachePath.c_str(), "rb") == 0 && file) {
+		const bool loaded = g_Index.Load(file, key);
+		fclose(file);
+
+		if (loaded) {
+			printf("[Delete Spells] Loaded cached xref index: %zu calls, %zu references\n", g_Index.GetCallCount(), g_Index.GetReferenceCount());
+			return true;
+		}
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	g_Index.Build(View(g_Text), g_Text.rva, threads);
+	printf("[Delete Spells] Built xref index in %.1f ms: %zu calls, %zu references\n",
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+		g_Index.GetCallCount(),
+		g_Index.GetReferenceCount()
+	);
+
+	if (fopen_s(&file, cachePath.c_str(), "wb") == 0 && file) {
+		if (!g_Index.Save(file, key))
+			printf("[Delete Spells] Failed to write xref index cache\n");
+		fclose(file);
+	}
+
+	return true;
+}
+
+const XrefIndex& ModuleXrefs::GetIndex()
+{
+	return g_Index;
+}
+
+uintptr_t ModuleXrefs::FindPattern(std::string_view pattern)
+{
+	if (!g_Base) return 0;
+
+	const auto offset = Pattern::Find(View(g_Text), pattern);
+	return offset ? g_Base + g_Text.rva + *offset : 0;
+}
+
+uintptr_t ModuleXrefs::ResolveCallAfter(std::string_view pattern, int offset)
+{
+	const uintptr_t match = FindPattern(pattern);
+	if (!match) return 0;
+
+	const uint32_t callee = g_Index.GetNextCallee(static_cast<uint32_t>(match + offset - g_Base));
+	return callee ? g_Base + callee : 0;
+}
+
+uintptr_t ModuleXrefs::FindFunctionReferencing(std::string_view text)
+{
+	if (!g_Base || text.empty()) return 0;
+
+	// Whole strings only: the terminator rules out "FooBar", and a terminator (or the section start)
+	// right before the match rules out the tail of "BarFoo"
+	std::vector<uint8_t> ascii(text.begin(), text.end());
+	ascii.push_back(0);
+
+	std::vector<uint8_t> wide;
+	for (const char c : text) {
+		wide.push_back(static_cast<uint8_t>(c));
+		wide.push_back(0);
+	}
+	wide.push_back(0);
+	wide.push_back(0);
+
+	for (const Section& section : g_DataSections) {
+		const auto data = View(section);
+
+		for (const auto& [needle, charSize] : { std::pair{ &ascii, size_t{ 1 } }, std::pair{ &wide, size_t{ 2 } } }) {
+			// The same string can be stored more than once, only some copies may be referenced
+			for (auto it = data.begin(); ; ++it) {
+				it = std::search(it, data.end(), needle->begin(), needle->end());
+				if (it == data.end()) break;
+
+				const auto offset = static_cast<size_t>(it - data.begin());
+				if (offset >= charSize && std::any_of(it - charSize, it, [](uint8_t b) { return b != 0; }))
+					continue;
+
+				const auto references = g_Index.GetReferencesTo(static_cast<uint32_t>(section.rva + offset));
+				if (!references.empty())
+					return GetFunctionStart(g_Base + references.front().from);
+			}
+		}
+	}
+
+	return 0;
+}
+
+uintptr_t ModuleXrefs::GetFunctionStart(uintptr_t address)
+{
+	if (!g_Base || g_Functions.empty()) return 0;
+
+	const auto rva = static_cast<DWORD>(address - g_Base);
+	auto it = std::upper_bound(g_Functions.begin(), g_Functions.end(), rva,
+		[](DWORD value, const RUNTIME_FUNCTION& function) { return value < function.BeginAddress; });
+	if (it == g_Functions.begin()) return 0;
+	--it;
+
+	if (rva >= it->EndAddress) return 0;
+
+	// Split functions chain their unwind info back to the primary entry
+	const RUNTIME_FUNCTION* function = &*it;
+	for (int depth = 0; depth < 32; ++depth) {
+		const auto* unwind = reinterpret_cast<const uint8_t*>(g_Base + function->UnwindData);
+		constexpr uint8_t kChainInfo = 0x4; // UNW_FLAG_CHAININFO
+		if (!((unwind[0] >> 3) & kChainInfo)) break;
+
+		// The chained RUNTIME_FUNCTION follows the unwind codes, which are padded to an even count
+		const uint8_t codeCount = unwind[2];
+		function = reinterpret_cast<const RUNTIME_FUNCTION*>(unwind + 4 + ((codeCount + 1) & ~1) * 2);
+	}
+
+	return g_Base + function->BeginAddress;
+}
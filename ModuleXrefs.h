@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+class XrefIndex;
+
+// XrefIndex over the game executable's .text section, with signature helpers on top of it.
+// The index is cached next to the config and rebuilt when the executable changes.
+class ModuleXrefs
+{
+public:
+	// `threads` is passed to XrefIndex::Build when there is no valid cache
+	static bool Init(unsigned threads);
+	static const XrefIndex& GetIndex();
+
+	// Absolute address of the first pattern match in .text, 0 if not found
+	static uintptr_t FindPattern(std::string_view pattern);
+
+	// Callee of the first call starting at or shortly after the pattern match
+	static uintptr_t ResolveCallAfter(std::string_view pattern, int offset = 0);
+
+	// Start of the function that references the ASCII or UTF-16 string `text`
+	static uintptr_t FindFunctionReferencing(std::string_view text);
+
+	// Start of the function containing `address`, from the exception directory
+	static uintptr_t GetFunctionStart(uintptr_t address);
+};
@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "PruneRules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+
+namespace
+{
+	// SpellItem::data.iSpellType values
+	constexpr const char* kSpellTypeNames[] = { "spell", "disease", "power", "lesserpower", "ability", "poison" };
+
+	bool ParseNumber(const std::string& text, uint32_t& out)
+	{
+		if (text.empty()) return false;
+
+		size_t used = 0;
+		try {
+			const unsigned long value = std::stoul(text, &used, 0);
+			if (used != text.size() || value > 0xFFFFFFFFul) return false;
+			out = static_cast<uint32_t>(value);
+			return true;
+		}
+		catch (...) {
+			return false;
+		}
+	}
+
+	std::string ToLower(std::string text)
+	{
+		for (char& c : text) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		return text;
+	}
+}
+
+const char* PruneRules::ActionName(Action action)
+{
+	switch (action) {
+	case Action::Reject: return "reject";
+	case Action::Queue: return "queue";
+	default: return "none";
+	}
+}
+
+const char* PruneRules::SpellTypeName(int spellType)
+{
+	if (spellType < 0 || spellType >= static_cast<int>(std::size(kSpellTypeNames))) return "unknown";
+	return kSpellTypeNames[spellType];
+}
+
+bool PruneRules::ParseSpellTypes(const std::string& value, uint8_t& mask)
+{
+	mask = 0;
+
+	std::istringstream types(ToLower(value));
+	std::string name;
+	while (std::getline(types, name, '|')) {
+		const auto it = std::ranges::find_if(kSpellTypeNames, [&](const char* n) { return name == n; });
+		uint32_t type = 0;
+
+		if (it != std::end(kSpellTypeNames))
+			type = static_cast<uint32_t>(it - std::begin(kSpellTypeNames));
+		else if (!ParseNumber(name, type) || type > 7)
+			return false;
+
+		mask |= static_cast<uint8_t>(1u << type);
+	}
+
+	return mask != 0;
+}
+
+bool PruneRules::ParseRule(const std::string& line, Rule& out)
+{
+	out = { 0, 0xFFFFFFFF, 0xFF, 0, Action::Queue };
+	bool hasTarget = false;
+
+	std::istringstream iss(line);
+	std::string token;
+
+	while (iss >> token) {
+		const auto eqPos = token.find('=');
+		if (eqPos == std::string::npos) return false;
+
+		const std::string key = ToLower(token.substr(0, eqPos));
+		const std::string value = ToLower(token.substr(eqPos + 1));
+
+		if (key == "formid") {
+			const auto dashPos = value.find('-');
+			if (!ParseNumber(value.substr(0, dashPos), out.first)) return false;
+			out.last = out.first;
+			if (dashPos != std::string::npos && !ParseNumber(value.substr(dashPos + 1), out.last)) return false;
+			if (out.last < out.first) return false;
+			hasTarget = true;
+		}
+		else if (key == "mod") {
+			uint32_t modIndex = 0;
+			if (!ParseNumber(value, modIndex) || modIndex > 0xFF) return false;
+			out.first = modIndex << 24;
+			out.last = out.first | 0x00FFFFFF;
+			hasTarget = true;
+		}
+		else if (key == "type") {
+			if (!ParseSpellTypes(value, out.typeMask)) return false;
+			hasTarget = true;
+		}
+		else if (key == "flags") {
+			uint32_t flags = 0;
+			if (!ParseNumber(value, flags) || flags > 0xFF) return false;
+			out.flags = static_cast<uint8_t>(flags);
+			hasTarget = true;
+		}
+		else if (key == "action") {
+			if (value == "reject") out.action = Action::Reject;
+			else if (value == "queue") out.action = Action::Queue;
+			else return false;
+		}
+		else {
+			return false;
+		}
+	}
+
+	// A rule without any filter would match every spell
+	return hasTarget;
+}
+
+void PruneRules::Compile(const std::vector<std::string>& lines)
+{
+	std::vector<Rule> rules;
+	rules.reserve(lines.size());
+
+	for (size_t i = 0; i < lines.size(); ++i) {
+		Rule rule{};
+		if (ParseRule(lines[i], rule))
+			rules.push_back(rule);
+		else
+			printf("[Delete Spells] Invalid spell rule %zu: %s\n", i + 1, lines[i].c_str());
+	}
+
+	m_Intervals.clear();
+	m_Conditions.clear();
+	m_RuleCount = rules.size();
+	if (rules.empty()) return;
+
+	// Every rule edge starts a new elementary interval
+	std::vector<uint64_t> bounds;
+	bounds.reserve(rules.size() * 2 + 1);
+	bounds.push_back(0);
+	for (const Rule& rule : rules) {
+		bounds.push_back(rule.first);
+		bounds.push_back(static_cast<uint64_t>(rule.last) + 1);
+	}
+	std::ranges::sort(bounds);
+	bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+	for (size_t i = 0; i < bounds.size() && bounds[i] <= 0xFFFFFFFF; ++i) {
+		const auto start = static_cast<uint32_t>(bounds[i]);
+		const auto offset = static_cast<uint32_t>(m_Conditions.size());
+
+		// Conditions keep rule order so the first matching rule wins
+		for (const Rule& rule : rules) {
+			if (rule.first <= start && start <= rule.last)
+				m_Conditions.push_back({ rule.typeMask, rule.flags, rule.action });
+		}
+
+		const auto count = static_cast<uint32_t>(m_Conditions.size()) - offset;
+
+		// Merge with the previous interval when both have no conditions
+		if (!count && !m_Intervals.empty() && !m_Intervals.back().count)
+			continue;
+
+		m_Intervals.push_back({ start, offset, count });
+	}
+}
+
+PruneRules::Action PruneRules::Match(uint32_t formID, int spellType, uint8_t flags) const
+{
+	if (m_Intervals.empty()) return Action::None;
+
+	// The first interval starts at 0, so there is always one at or before formID
+	const auto it = std::upper_bound(m_Intervals.begin(), m_Intervals.end(), formID,
+		[](uint32_t id, const Interval& interval) { return id < interval.start; });
+	const Interval& interval = *(it - 1);
+
+	const uint8_t typeBit = (spellType >= 0 && spellType < 8) ? static_cast<uint8_t>(1u << spellType) : 0;
+
+	for (uint32_t i = 0; i < interval.count; ++i) {
+		const Condition& condition = m_Conditions[interval.offset + i];
+		if ((condition.typeMask & typeBit) && (flags & condition.flags) == condition.flags)
+			return condition.action;
+	}
+
+	return Action::None;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rules deciding what happens to a spell when it is added to the player.
+// Rules are compiled once into a flat table of disjoint FormID intervals, each pointing at the
+// conditions of the rules covering it, so Match is a binary search with no allocation.
+// Has no game dependencies so it can also be used outside the plugin.
+class PruneRules
+{
+public:
+	enum class Action : uint8_t
+	{
+		None,
+		Reject,	// Stop the spell from being added
+		Queue,	// Let it be added, remove it at the next safe point
+	};
+
+	// Lines use whitespace separated key=value pairs, e.g. "mod=0x0A type=spell action=reject".
+	// Invalid lines are logged with their index and skipped.
+	void Compile(const std::vector<std::string>& lines);
+
+	Action Match(uint32_t formID, int spellType, uint8_t flags) const;
+
+	bool IsEmpty() const { return m_Intervals.empty(); }
+	size_t GetRuleCount() const { return m_RuleCount; }
+
+	static const char* ActionName(Action action);
+	static const char* SpellTypeName(int spellType);
+
+	// Parses "spell|power|3" style lists into a bit per spell type
+	static bool ParseSpellTypes(const std::string& value, uint8_t& mask);
+
+private:
+	struct Rule
+	{
+		uint32_t first;
+		uint32_t last;
+		uint8_t typeMask;	// Bit per spell type, all set when the rule has no type filter
+		uint8_t flags;		// All of these flag bits must be set
+		Action action;
+	};
+
+	struct Condition
+	{
+		uint8_t typeMask;
+		uint8_t flags;
+		Action action;
+	};
+
+	struct Interval
+	{
+		uint32_t start;		// Interval runs until the next start
+		uint32_t offset;	// Into m_Conditions
+		uint32_t count;
+	};
+
+	static bool ParseRule(const std::string& line, Rule& out);
+
+	std::vector<Interval> m_Intervals;
+	std::vector<Condition> m_Conditions;
+	size_t m_RuleCount = 0;
+};
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "SaveProfile.h"
+#include "ConfigFile.h"
+
+#include <filesystem>
+
+const std::string& SaveProfile::GetName()
+{
+	static const std::string name = [] {
+		std::string value = ConfigFile::GetString("sSaveProfile", "Default");
+
+		// Keep the name usable as a file name
+		for (char& c : value) {
+			if (c == '\\' || c == '/' || c == ':' || c == '*' || c == '?' || c == '"' || c == '<' || c == '>' || c == '|')
+				c = '_';
+		}
+		return value.empty() ? std::string("Default") : value;
+		}();
+	return name;
+}
+
+uint64_t SaveProfile::GetId()
+{
+	// FNV-1a, stable across runs and builds
+	static const uint64_t id = [] {
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (const char c : GetName()) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 0x100000001B3ull;
+		}
+		return hash;
+		}();
+	return id;
+}
+
+std::string SaveProfile::GetDataDirectory()
+{
+	const std::filesystem::path dir = std::filesystem::path(ConfigFile::GetConfigDirectory()) / "DeleteSpells";
+
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (ec) {
+		printf("[Delete Spells] Failed to create data directory %s: %s\n", dir.string().c_str(), ec.message().c_str());
+	}
+
+	return dir.string();
+}
+
+std::string SaveProfile::GetDataPath(std::string_view extension)
+{
+	return (std::filesystem::path(GetDataDirectory()) / (GetName() + std::string(extension))).string();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Identifies the playthrough the plugin's data files belong to.
+// OBSE64 does not report which save is loaded, so saves are grouped by the sSaveProfile config value.
+class SaveProfile
+{
+public:
+	static const std::string& GetName();
+	static uint64_t GetId();
+
+	// Returns <config dir>\DeleteSpells, creating it if needed. Holds files shared by all profiles
+	static std::string GetDataDirectory();
+
+	// Returns <config dir>\DeleteSpells\<profile><extension>
+	static std::string GetDataPath(std::string_view extension);
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Actor.h"
+#include "PlayerCharacter.h"
+#include "SpellItem.h"
+#include "EffectItem.h"
+#include "EffectItemList.h"
+#include "EffectSetting.h"
+#include "EFormType.h"
+#include "TESForm.h"
+#include "TESObjectCELL.h"
+#include "TESObjectREFR.h"
+#include "SpellEffect.h"
+
+#include <vector>
+
+// Helpers for walking the spells an actor knows. Kept in one place so feature code
+// does not depend on the ObSDK list layout.
+namespace SpellAccess
+{
+	template <typename Fn>
+	void ForEachSpell(Actor* actor, Fn&& fn) {
+		if (!actor) return;
+
+		for (auto* node = actor->GetSpellList(); node; node = node->m_pNext) {
+			if (node->m_item)
+				fn(node->m_item);
+		}
+	}
+
+	template <typename Fn>
+	void ForEachPlayerSpell(Fn&& fn) {
+		ForEachSpell(PlayerCharacter::GetSingleton(), fn);
+	}
+
+	// Actors referenced by the player's current cell, the player included
+	template <typename Fn>
+	void ForEachLoadedActor(Fn&& fn) {
+		auto* player = PlayerCharacter::GetSingleton();
+		TESObjectCELL* cell = player ? player->GetParentCell() : nullptr;
+		if (!cell) return;
+
+		for (auto* node = &cell->xObjectList; node; node = node->m_pNext) {
+			TESObjectREFR* ref = node->m_item;
+			if (!ref) continue;
+
+			const auto type = ref->GetFormType();
+			if (type == EFormType::Character || type == EFormType::Creature)
+				fn(static_cast<Actor*>(ref));
+		}
+	}
+
+	inline const char* GetName(SpellItem* spell) {
+		const char* name = spell->cFullName.c_str();
+		return name ? name : "";
+	}
+
+	// Resolves a FormID saved earlier, returns nullptr if it is not a spell in the loaded game
+	inline SpellItem* LookupSpell(uint32_t formID) {
+		TESForm* form = TESForm::LookupByID(formID);
+		if (!form || form->GetFormType() != EFormType::Spell) return nullptr;
+		return static_cast<SpellItem*>(form);
+	}
+
+	// Removing while walking would invalidate the list, so callers collect first
+	inline std::vector<SpellItem*> CollectPlayerSpells() {
+		std::vector<SpellItem*> spells;
+		ForEachPlayerSpell([&](SpellItem* spell) { spells.push_back(spell); });
+		return spells;
+	}
+
+	// Scripted effects (SEFF) share the effect code and usually 0/0 numbers, what they do is the script.
+	// Their hostility comes from the script info rather than the effect setting.
+	inline SpellEffect ToSpellEffect(const EffectItem* effect) {
+		const auto& data = effect->data;
+		const ScriptEffectInfo* script = effect->pScriptEffectInfo;
+
+		constexpr uint32_t kEffectSettingHostile = 0x1;
+		bool hostile = effect->pEffectSetting && (effect->pEffectSetting->iFlags & kEffectSettingHostile);
+		if (script)
+			hostile = script->bIsHostile != 0;
+
+		return SpellEffect{
+			data.iEffectID,
+			data.iMagnitude,
+			data.iArea,
+			data.iDuration,
+			data.iRange,
+			data.iActorValue,
+			script ? script->iScriptFormID : 0,
+			hostile ? SpellEffectFlags::Hostile : 0
+		};
+	}
+
+	template <typename Fn>
+	void ForEachEffect(SpellItem* spell, Fn&& fn) {
+		for (auto* node = &spell->xEffects.xEffectList; node; node = node->m_pNext) {
+			if (node->m_item)
+				fn(node->m_item);
+		}
+	}
+
+	// Appends the spell's effects to `out` and returns how many were added
+	inline size_t AppendEffects(SpellItem* spell, std::vector<SpellEffect>& out) {
+		const size_t before = out.size();
+		ForEachEffect(spell, [&](EffectItem* effect) { out.push_back(ToSpellEffect(effect)); });
+		return out.size() - before;
+	}
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+#include "SpellDuplicates.h"
+#include "SpellAccess.h"
+#include "SpellEffect.h"
+#include "SpellStats.h"
+
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+
+namespace
+{
+	struct Entry
+	{
+		SpellItem* spell;
+		uint64_t fingerprint;
+		uint32_t effectOffset;
+		uint32_t effectCount;
+		int32_t spellType;
+		uint8_t spellFlags;
+	};
+
+	// Spells with the same effects in a different order behave the same, so effects are sorted first
+	uint64_t Fingerprint(const Entry& entry, std::span<const SpellEffect> effects)
+	{
+		const uint64_t spell = (static_cast<uint64_t>(entry.spellFlags) << 32) | static_cast<uint32_t>(entry.spellType);
+		uint64_t hash = SpellHash::Mix(spell + effects.size());
+		for (const SpellEffect& effect : effects)
+			hash = SpellHash::Combine(hash, SpellHash::Effect(effect));
+		return hash;
+	}
+
+	// The spell to keep: the most used one, or the oldest when there are no stats
+	bool KeepBefore(const SpellItem* a, const SpellItem* b)
+	{
+		const auto statsA = SpellStats::Get(a->iFormID);
+		const auto statsB = SpellStats::Get(b->iFormID);
+		const uint32_t castsA = statsA ? statsA->castCount : 0;
+		const uint32_t castsB = statsB ? statsB->castCount : 0;
+
+		if (castsA != castsB) return castsA > castsB;
+		return a->iFormID < b->iFormID;
+	}
+}
+
+std::vector<SpellDuplicates::Group> SpellDuplicates::Find(const std::vector<SpellItem*>& spells)
+{
+	std::vector<Entry> entries;
+	std::vector<SpellEffect> effects;
+	entries.reserve(spells.size());
+	effects.reserve(spells.size() * 2);
+
+	for (SpellItem* spell : spells) {
+		const auto offset = static_cast<uint32_t>(effects.size());
+		const auto count = static_cast<uint32_t>(SpellAccess::AppendEffects(spell, effects));
+		if (!count) continue;
+
+		const auto begin = effects.begin() + offset;
+		std::sort(begin, begin + count);
+
+		entries.push_back({ spell, 0, offset, count, spell->data.iSpellType, spell->data.flags });
+	}
+
+	// Fingerprint after collection, since appending may have moved the effect storage
+	std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+	buckets.reserve(entries.size());
+
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		Entry& entry = entries[i];
+		entry.fingerprint = Fingerprint(entry, { effects.data() + entry.effectOffset, entry.effectCount });
+		buckets[entry.fingerprint].push_back(i);
+	}
+
+	auto sameEffects = [&](const Entry& a, const Entry& b) {
+		return a.spellType == b.spellType && a.spellFlags == b.spellFlags && std::ranges::equal(
+			std::span(effects.data() + a.effectOffset, a.effectCount),
+			std::span(effects.data() + b.effectOffset, b.effectCount));
+		};
+
+	std::vector<Group> groups;
+
+	for (auto& [fingerprint, indices] : buckets) {
+		if (indices.size() < 2) continue;
+
+		// Split the bucket into classes of exactly equal effect lists; a true 64-bit collision ends up in its own class
+		while (!indices.empty()) {
+			const Entry& first = entries[indices.front()];
+			Group group;
+
+			std::erase_if(indices, [&](uint32_t index) {
+				if (!sameEffects(first, entries[index])) return false;
+				group.spells.push_back(entries[index].spell);
+				return true;
+				});
+
+			if (group.spells.size() < 2) continue;
+
+			std::sort(group.spells.begin(), group.spells.end(), KeepBefore);
+			groups.push_back(std::move(group));
+		}
+	}
+
+	return groups;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class SpellItem;
+
+// Finds spells with identical effect lists, e.g. the same custom spell made twice at a spellmaking altar.
+// Each spell is reduced to a 64-bit fingerprint of its sorted effects, so grouping is a single
+// hash pass instead of comparing every pair. Fingerprint matches are confirmed by exact comparison.
+// Spell type and flags, and each effect's script and hostility, are part of the comparison, so
+// scripted powers that only differ in their script are never grouped. The caller picks the candidates.
+class SpellDuplicates
+{
+public:
+	struct Group
+	{
+		// spells[0] is the representative to keep
+		std::vector<SpellItem*> spells;
+	};
+
+	static std::vector<Group> Find(const std::vector<SpellItem*>& spells);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+
+// Plain copy of the fields of an EffectItem that decide what a spell does.
+// Holds no game pointers, so it is safe to keep across frames and threads.
+struct SpellEffect
+{
+	uint32_t effectID;		// EffectSetting code
+	int32_t magnitude;
+	int32_t area;
+	int32_t duration;
+	int32_t range;			// Self, Touch, Target
+	int32_t actorValue;		// Attribute or skill for effects such as Fortify
+	uint32_t scriptFormID;	// Script run by a scripted effect (SEFF), 0 otherwise
+	uint32_t flags;			// SpellEffectFlags
+
+	auto operator<=>(const SpellEffect&) const = default;
+};
+
+namespace SpellEffectFlags
+{
+	constexpr uint32_t Hostile = 1 << 0;
+}
+
+namespace SpellHash
+{
+	// splitmix64 finalizer
+	constexpr uint64_t Mix(uint64_t x) {
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9ull;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EBull;
+		x ^= x >> 31;
+		return x;
+	}
+
+	constexpr uint64_t Combine(uint64_t seed, uint64_t value) {
+		return Mix(seed ^ (value + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2)));
+	}
+
+	constexpr uint64_t Effect(const SpellEffect& e) {
+		uint64_t h = Mix((static_cast<uint64_t>(e.effectID) << 32) | static_cast<uint32_t>(e.actorValue));
+		h = Combine(h, (static_cast<uint64_t>(static_cast<uint32_t>(e.magnitude)) << 32) | static_cast<uint32_t>(e.area));
+		h = Combine(h, (static_cast<uint64_t>(static_cast<uint32_t>(e.duration)) << 32) | static_cast<uint32_t>(e.range));
+		h = Combine(h, (static_cast<uint64_t>(e.scriptFormID) << 32) | e.flags);
+		return h;
+	}
+}
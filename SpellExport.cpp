@@ -0,0 +1,96 @@
+#include "pch.h"
+#include "SpellExport.h"
+#include "ConfigFile.h"
+#include "SaveProfile.h"
+#include "SpellAccess.h"
+#include "SpellSnapshot.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+static std::atomic<bool> s_Busy{ false };
+
+// Sized from the previous export so repeated captures do not reallocate
+static size_t s_LastSpellCount = 256;
+static size_t s_LastEffectCount = 512;
+static size_t s_LastNamesSize = 256 * 24;
+
+static void Capture(SpellSnapshot& snapshot)
+{
+	snapshot.spells.reserve(s_LastSpellCount);
+	snapshot.effects.reserve(s_LastEffectCount);
+	snapshot.names.reserve(s_LastNamesSize);
+
+	SpellAccess::ForEachPlayerSpell([&](SpellItem* spell) {
+		const char* name = SpellAccess::GetName(spell);
+		const auto nameLength = static_cast<uint32_t>(strlen(name));
+		const auto& data = spell->data;
+
+		SpellSnapshot::Spell entry{};
+		entry.formID = spell->iFormID;
+		entry.spellType = data.iSpellType;
+		entry.cost = data.iCostOverride;
+		entry.flags = data.flags;
+		entry.nameOffset = static_cast<uint32_t>(snapshot.names.size());
+		entry.nameLength = nameLength;
+		entry.effectOffset = static_cast<uint32_t>(snapshot.effects.size());
+		entry.effectCount = static_cast<uint32_t>(SpellAccess::AppendEffects(spell, snapshot.effects));
+
+		snapshot.names.append(name, nameLength);
+		snapshot.spells.push_back(entry);
+		});
+
+	s_LastSpellCount = snapshot.spells.size();
+	s_LastEffectCount = snapshot.effects.size();
+	s_LastNamesSize = snapshot.names.size();
+}
+
+void SpellExport::Run()
+{
+	if (s_Busy.exchange(true)) {
+		printf("[Delete Spells] Export already in progress\n");
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	SpellSnapshot snapshot;
+	Capture(snapshot);
+	const auto captured = std::chrono::steady_clock::now();
+
+	printf("[Delete Spells] Captured %zu spells in %.3f ms\n",
+		snapshot.spells.size(),
+		std::chrono::duration<double, std::milli>(captured - start).count()
+	);
+
+	const auto format = SpellSnapshot::ParseFormat(ConfigFile::GetString("sExportFormat", "csv"));
+	std::string path = SaveProfile::GetDataPath(std::string("_spells") + SpellSnapshot::GetExtension(format));
+
+	std::thread([snapshot = std::move(snapshot), path = std::move(path), format] {
+		const auto writeStart = std::chrono::steady_clock::now();
+
+		FILE* file = nullptr;
+		if (fopen_s(&file, path.c_str(), "wb") != 0 || !file) {
+			printf("[Delete Spells] Failed to open export file: %s\n", path.c_str());
+			s_Busy = false;
+			return;
+		}
+
+		const bool written = snapshot.Write(file, format);
+		const bool closed = fclose(file) == 0;
+
+		if (written && closed) {
+			printf("[Delete Spells] Exported %zu spells to %s in %.2f ms\n",
+				snapshot.spells.size(),
+				path.c_str(),
+				std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count()
+			);
+		}
+		else {
+			printf("[Delete Spells] Failed to write export file: %s\n", path.c_str());
+		}
+
+		s_Busy = false;
+		}).detach();
+}
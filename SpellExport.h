@@ -0,0 +1,10 @@
+#pragma once
+
+// Exports the player's spell list for auditing. The list is copied on the game thread and
+// written by a worker thread as CSV or JSON Lines, so only the copy costs frame time.
+class SpellExport
+{
+public:
+	// Game thread only
+	static void Run();
+};
@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "SpellProfiler.h"
+#include "PruneRules.h"
+#include "SpellAccess.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	// Sizes of the list nodes the game allocates per spell and per effect. The first effect node is
+	// stored inline in the spell, every further one is a separate allocation.
+	constexpr size_t kSpellNodeSize = sizeof(*std::declval<Actor&>().GetSpellList());
+	constexpr size_t kEffectNodeSize = sizeof(std::declval<SpellItem&>().xEffects.xEffectList);
+
+	// Rebuilds are timed a few times and the fastest run is reported, the first one pays for cold caches
+	constexpr int kUpdateListRuns = 3;
+
+	struct SpellCost
+	{
+		uint32_t formID;
+		int32_t spellType;
+		size_t effects;
+		size_t bytes;
+		const char* name;
+	};
+
+	struct Bucket
+	{
+		size_t spells = 0;
+		size_t effects = 0;
+		size_t bytes = 0;
+	};
+
+	size_t EstimateFootprint(size_t nameLength, size_t effects)
+	{
+		size_t bytes = sizeof(SpellItem) + kSpellNodeSize + nameLength + 1;
+		bytes += effects * sizeof(EffectItem);
+		if (effects > 1)
+			bytes += (effects - 1) * kEffectNodeSize;
+		return bytes;
+	}
+
+	template <typename Key>
+	std::vector<std::pair<Key, Bucket>> RankByBytes(const std::map<Key, Bucket>& buckets)
+	{
+		std::vector<std::pair<Key, Bucket>> ranked(buckets.begin(), buckets.end());
+		std::ranges::stable_sort(ranked, [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+		return ranked;
+	}
+
+	double Percent(size_t part, size_t total)
+	{
+		return total ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+	}
+
+	void PrintBucketHeader(const char* title)
+	{
+		printf("[Delete Spells] %s\n", title);
+		printf("[Delete Spells]   %-16s %8s %8s %10s %7s\n", "", "Spells", "Effects", "Bytes", "Share");
+	}
+
+	void PrintBucket(const char* label, const Bucket& bucket, size_t totalBytes)
+	{
+		printf("[Delete Spells]   %-16s %8zu %8zu %10zu %6.1f%%\n",
+			label,
+			bucket.spells,
+			bucket.effects,
+			bucket.bytes,
+			Percent(bucket.bytes, totalBytes)
+		);
+	}
+}
+
+void SpellProfiler::Run(size_t topSpells)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<SpellCost> spells;
+	std::map<int32_t, Bucket> byType;
+	std::map<size_t, Bucket> byEffectCount;
+	std::map<uint32_t, Bucket> byMod;
+	Bucket total;
+
+	SpellAccess::ForEachPlayerSpell([&](SpellItem* spell) {
+		size_t effects = 0;
+		SpellAccess::ForEachEffect(spell, [&](EffectItem*) { effects++; });
+
+		const char* name = SpellAccess::GetName(spell);
+		const SpellCost cost{ spell->iFormID, spell->data.iSpellType, effects, EstimateFootprint(strlen(name), effects), name };
+		spells.push_back(cost);
+
+		for (Bucket* bucket : { &byType[cost.spellType], &byEffectCount[cost.effects], &byMod[cost.formID >> 24], &total }) {
+			bucket->spells++;
+			bucket->effects += cost.effects;
+			bucket->bytes += cost.bytes;
+		}
+		});
+
+	const double walkMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	printf("[Delete Spells] Spell profile: %zu spells, %zu effects, ~%zu bytes | walk %.3f ms\n", total.spells, total.effects, total.bytes, walkMs);
+
+	char label[32];
+
+	PrintBucketHeader("By type");
+	for (const auto& [type, bucket] : RankByBytes(byType))
+		PrintBucket(PruneRules::SpellTypeName(type), bucket, total.bytes);
+
+	PrintBucketHeader("By effect count");
+	for (const auto& [effects, bucket] : RankByBytes(byEffectCount)) {
+		snprintf(label, sizeof(label), "%zu effects", effects);
+		PrintBucket(label, bucket, total.bytes);
+	}
+
+	// Mod index FF holds spells created in game, the usual source of oversized lists
+	PrintBucketHeader("By mod index");
+	for (const auto& [mod, bucket] : RankByBytes(byMod)) {
+		if (mod == 0xFF)
+			snprintf(label, sizeof(label), "FF (created)");
+		else
+			snprintf(label, sizeof(label), "%02X", mod);
+		PrintBucket(label, bucket, total.bytes);
+	}
+
+	const size_t shown = std::min(topSpells, spells.size());
+	if (shown) {
+		std::ranges::partial_sort(spells, spells.begin() + shown, [](const SpellCost& a, const SpellCost& b) { return a.bytes > b.bytes; });
+
+		printf("[Delete Spells] Largest %zu spells\n", shown);
+		for (size_t i = 0; i < shown; ++i) {
+			const SpellCost& cost = spells[i];
+			printf("[Delete Spells]   %3zu. %08X %-12s %2zu effects %6zu bytes  %s\n",
+				i + 1,
+				cost.formID,
+				PruneRules::SpellTypeName(cost.spellType),
+				cost.effects,
+				cost.bytes,
+				cost.name
+			);
+		}
+	}
+}
+
+void SpellProfiler::TimeRebuild(UpdateListFn updateList)
+{
+	size_t spellCount = 0;
+	SpellAccess::ForEachPlayerSpell([&](SpellItem*) { spellCount++; });
+
+	double fastestMs = 0;
+	double totalMs = 0;
+	for (int run = 0; run < kUpdateListRuns; ++run) {
+		const auto before = std::chrono::steady_clock::now();
+		updateList();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - before).count();
+
+		fastestMs = run == 0 ? ms : std::min(fastestMs, ms);
+		totalMs += ms;
+	}
+
+	printf("[Delete Spells] Magic menu rebuild at %zu spells: fastest %.3f ms, average %.3f ms (%.2f us per spell)\n",
+		spellCount,
+		fastestMs,
+		totalMs / kUpdateListRuns,
+		spellCount ? fastestMs * 1000.0 / static_cast<double>(spellCount) : 0.0
+	);
+}
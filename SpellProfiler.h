@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Logs where the player's spell list spends memory and Magic menu time.
+// Walks the list once and totals spells by type, effect count and owning mod, with an estimated
+// footprint per spell (the SpellItem, its name and its effect list nodes). The tables are ranked by
+// bytes so the groups worth deleting come first.
+class SpellProfiler
+{
+public:
+	using UpdateListFn = void(*)();
+
+	// Game thread only
+	static void Run(size_t topSpells);
+
+	// Game thread only, right after the game rebuilt the Magic menu list and no rebuild is in progress.
+	// `updateList` rebuilds the Magic menu list
+	static void TimeRebuild(UpdateListFn updateList);
+};
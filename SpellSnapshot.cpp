@@ -0,0 +1,381 @@
+#include "pch.h"
+#include "SpellSnapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace
+{
+	// Collects output and hands it to the file in large blocks
+	class BufferedWriter
+	{
+	public:
+		explicit BufferedWriter(FILE* file) : m_File(file) { m_Buffer.reserve(kBlockSize + 1024); }
+
+		void Append(std::string_view text) {
+			m_Buffer.append(text);
+			if (m_Buffer.size() >= kBlockSize) Flush();
+		}
+
+		template <typename... Args>
+		void Format(const char* format, Args... args) {
+			char line[128];
+			const int length = snprintf(line, sizeof(line), format, args...);
+			if (length > 0) Append(std::string_view(line, std::min<size_t>(length, sizeof(line) - 1)));
+		}
+
+		bool Flush() {
+			if (!m_Buffer.empty() && fwrite(m_Buffer.data(), 1, m_Buffer.size(), m_File) != m_Buffer.size())
+				m_Failed = true;
+			m_Buffer.clear();
+			return !m_Failed;
+		}
+
+	private:
+		static constexpr size_t kBlockSize = 64 * 1024;
+
+		FILE* m_File;
+		std::string m_Buffer;
+		bool m_Failed = false;
+	};
+
+	// Read parses one spell per line, so line breaks in names become spaces
+	void AppendCsvField(BufferedWriter& out, std::string_view text)
+	{
+		out.Append("\"");
+		for (size_t pos = 0; pos < text.size();) {
+			const size_t special = text.find_first_of("\"\r\n", pos);
+			out.Append(text.substr(pos, special - pos));
+			if (special == std::string_view::npos) break;
+			out.Append(text[special] == '"' ? "\"\"" : " ");
+			pos = special + 1;
+		}
+		out.Append("\"");
+	}
+
+	// Names are bytes in the game's code page, not UTF-8. Bytes from 0x80 are escaped as \u00XX so
+	// the output is plain ASCII and valid JSON, and Read turns them back into the same bytes
+	void AppendJsonString(BufferedWriter& out, std::string_view text)
+	{
+		out.Append("\"");
+		for (const char c : text) {
+			switch (c) {
+			case '"': out.Append("\\\""); break;
+			case '\\': out.Append("\\\\"); break;
+			case '\n': out.Append("\\n"); break;
+			case '\r': out.Append("\\r"); break;
+			case '\t': out.Append("\\t"); break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20 || static_cast<unsigned char>(c) >= 0x80)
+					out.Format("\\u%04X", static_cast<unsigned>(static_cast<unsigned char>(c)));
+				else
+					out.Append(std::string_view(&c, 1));
+			}
+		}
+		out.Append("\"");
+	}
+
+	// Parsing helpers for Read. Each consumes what it parsed from the front of `text`
+	bool Expect(std::string_view& text, char c)
+	{
+		if (!text.starts_with(c)) return false;
+		text.remove_prefix(1);
+		return true;
+	}
+
+	void SkipSpace(std::string_view& text)
+	{
+		while (!text.empty() && isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+	}
+
+	// Decimal, or hex with a 0x prefix as the writer formats FormIDs and flags
+	template <typename T>
+	bool ParseInt(std::string_view& text, T& out)
+	{
+		int base = 10;
+		if (text.starts_with("0x") || text.starts_with("0X")) {
+			text.remove_prefix(2);
+			base = 16;
+		}
+
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), out, base);
+		if (error != std::errc()) return false;
+		text.remove_prefix(end - text.data());
+		return true;
+	}
+
+	bool ParseEffectCsv(std::string_view& text, SpellEffect& e)
+	{
+		return ParseInt(text, e.effectID)
+			&& Expect(text, ':') && ParseInt(text, e.magnitude)
+			&& Expect(text, ':') && ParseInt(text, e.area)
+			&& Expect(text, ':') && ParseInt(text, e.duration)
+			&& Expect(text, ':') && ParseInt(text, e.range)
+			&& Expect(text, ':') && ParseInt(text, e.actorValue);
+	}
+
+	bool ReadCsvLine(std::string_view line, SpellSnapshot& snapshot)
+	{
+		SpellSnapshot::Spell spell{};
+		if (!ParseInt(line, spell.formID) || !Expect(line, ',') || !Expect(line, '"')) return false;
+
+		// Quoted name, "" stands for a quote
+		spell.nameOffset = static_cast<uint32_t>(snapshot.names.size());
+		for (;;) {
+			const size_t quote = line.find('"');
+			if (quote == std::string_view::npos) return false;
+			snapshot.names.append(line.substr(0, quote));
+			line.remove_prefix(quote + 1);
+			if (!Expect(line, '"')) break;
+			snapshot.names.push_back('"');
+		}
+		spell.nameLength = static_cast<uint32_t>(snapshot.names.size() - spell.nameOffset);
+
+		if (!Expect(line, ',') || !ParseInt(line, spell.spellType)
+			|| !Expect(line, ',') || !ParseInt(line, spell.cost)
+			|| !Expect(line, ',') || !ParseInt(line, spell.flags)
+			|| !Expect(line, ','))
+			return false;
+
+		spell.effectOffset = static_cast<uint32_t>(snapshot.effects.size());
+		while (!line.empty()) {
+			SpellEffect e{};
+			if ((spell.effectCount && !Expect(line, '|')) || !ParseEffectCsv(line, e)) return false;
+			snapshot.effects.push_back(e);
+			spell.effectCount++;
+		}
+
+		snapshot.spells.push_back(spell);
+		return true;
+	}
+
+	void AppendUtf8(std::string& out, uint32_t code)
+	{
+		if (code < 0x80) {
+			out.push_back(static_cast<char>(code));
+		}
+		else if (code < 0x800) {
+			out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+			out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+		}
+		else {
+			out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+			out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+		}
+	}
+
+	bool ReadJsonString(std::string_view& text, std::string& out)
+	{
+		if (!Expect(text, '"')) return false;
+
+		while (!text.empty()) {
+			const char c = text.front();
+			text.remove_prefix(1);
+
+			if (c == '"') return true;
+			if (c != '\\') {
+				out.push_back(c);
+				continue;
+			}
+
+			if (text.empty()) return false;
+			const char escaped = text.front();
+			text.remove_prefix(1);
+
+			switch (escaped) {
+			case 'n': out.push_back('\n'); break;
+			case 'r': out.push_back('\r'); break;
+			case 't': out.push_back('\t'); break;
+			case 'u': {
+				uint32_t code = 0;
+				if (text.size() < 4) return false;
+				const auto [end, error] = std::from_chars(text.data(), text.data() + 4, code, 16);
+				if (error != std::errc() || end != text.data() + 4) return false;
+				text.remove_prefix(4);
+
+				// Up to 0xFF is a code page byte escaped by Write
+				if (code < 0x100)
+					out.push_back(static_cast<char>(code));
+				else
+					AppendUtf8(out, code);
+				break;
+			}
+			default: out.push_back(escaped); break;
+			}
+		}
+		return false;
+	}
+
+	// FormIDs and effect IDs are written as "0x%08X" strings
+	bool ReadJsonHex(std::string_view& text, uint32_t& out)
+	{
+		std::string value;
+		if (!ReadJsonString(text, value)) return false;
+
+		std::string_view digits(value);
+		return ParseInt(digits, out) && digits.empty();
+	}
+
+	// Calls read(key, text) for each member, read consumes the value
+	template <typename Fn>
+	bool ReadJsonObject(std::string_view& text, Fn&& read)
+	{
+		SkipSpace(text);
+		if (!Expect(text, '{')) return false;
+		SkipSpace(text);
+		if (Expect(text, '}')) return true;
+
+		std::string key;
+		for (;;) {
+			SkipSpace(text);
+			key.clear();
+			if (!ReadJsonString(text, key)) return false;
+			SkipSpace(text);
+			if (!Expect(text, ':')) return false;
+			SkipSpace(text);
+			if (!read(key, text)) return false;
+			SkipSpace(text);
+			if (Expect(text, '}')) return true;
+			if (!Expect(text, ',')) return false;
+		}
+	}
+
+	bool ReadJsonEffects(std::string_view& text, SpellSnapshot& snapshot, SpellSnapshot::Spell& spell)
+	{
+		if (!Expect(text, '[')) return false;
+		SkipSpace(text);
+		if (Expect(text, ']')) return true;
+
+		for (;;) {
+			SpellEffect e{};
+			const bool parsed = ReadJsonObject(text, [&](const std::string& key, std::string_view& value) {
+				if (key == "id") return ReadJsonHex(value, e.effectID);
+				if (key == "magnitude") return ParseInt(value, e.magnitude);
+				if (key == "area") return ParseInt(value, e.area);
+				if (key == "duration") return ParseInt(value, e.duration);
+				if (key == "range") return ParseInt(value, e.range);
+				if (key == "actorValue") return ParseInt(value, e.actorValue);
+				return false;
+				});
+			if (!parsed) return false;
+
+			snapshot.effects.push_back(e);
+			spell.effectCount++;
+
+			SkipSpace(text);
+			if (Expect(text, ']')) return true;
+			if (!Expect(text, ',')) return false;
+		}
+	}
+
+	bool ReadJsonLine(std::string_view line, SpellSnapshot& snapshot)
+	{
+		SpellSnapshot::Spell spell{};
+		spell.effectOffset = static_cast<uint32_t>(snapshot.effects.size());
+
+		const bool parsed = ReadJsonObject(line, [&](const std::string& key, std::string_view& value) {
+			if (key == "formId") return ReadJsonHex(value, spell.formID);
+			if (key == "type") return ParseInt(value, spell.spellType);
+			if (key == "cost") return ParseInt(value, spell.cost);
+			if (key == "flags") return ParseInt(value, spell.flags);
+			if (key == "effects") return ReadJsonEffects(value, snapshot, spell);
+			if (key == "name") {
+				spell.nameOffset = static_cast<uint32_t>(snapshot.names.size());
+				if (!ReadJsonString(value, snapshot.names)) return false;
+				spell.nameLength = static_cast<uint32_t>(snapshot.names.size() - spell.nameOffset);
+				return true;
+			}
+			return false;
+			});
+
+		SkipSpace(line);
+		if (!parsed || !line.empty()) return false;
+
+		snapshot.spells.push_back(spell);
+		return true;
+	}
+}
+
+void SpellSnapshot::Clear()
+{
+	spells.clear();
+	effects.clear();
+	names.clear();
+}
+
+SpellSnapshot::Format SpellSnapshot::ParseFormat(std::string_view name)
+{
+	std::string lower(name);
+	for (char& c : lower) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	return (lower == "json" || lower == "jsonl") ? Format::JsonLines : Format::Csv;
+}
+
+const char* SpellSnapshot::GetExtension(Format format)
+{
+	return format == Format::JsonLines ? ".jsonl" : ".csv";
+}
+
+bool SpellSnapshot::Write(FILE* file, Format format) const
+{
+	BufferedWriter out(file);
+
+	// CSV effects column: effectID:magnitude:area:duration:range:actorValue, separated by '|'
+	if (format == Format::Csv)
+		out.Append("FormID,Name,Type,Cost,Flags,Effects\n");
+
+	for (const Spell& spell : spells) {
+		const SpellEffect* spellEffects = GetEffects(spell);
+
+		if (format == Format::Csv) {
+			out.Format("0x%08X,", spell.formID);
+			AppendCsvField(out, GetName(spell));
+			out.Format(",%d,%d,0x%02X,", spell.spellType, spell.cost, spell.flags);
+
+			for (uint32_t i = 0; i < spell.effectCount; ++i) {
+				const SpellEffect& e = spellEffects[i];
+				out.Format("%s0x%08X:%d:%d:%d:%d:%d", i ? "|" : "", e.effectID, e.magnitude, e.area, e.duration, e.range, e.actorValue);
+			}
+			out.Append("\n");
+		}
+		else {
+			out.Format("{\"formId\":\"0x%08X\",\"name\":", spell.formID);
+			AppendJsonString(out, GetName(spell));
+			out.Format(",\"type\":%d,\"cost\":%d,\"flags\":%u,\"effects\":[", spell.spellType, spell.cost, spell.flags);
+
+			for (uint32_t i = 0; i < spell.effectCount; ++i) {
+				const SpellEffect& e = spellEffects[i];
+				out.Format("%s{\"id\":\"0x%08X\",", i ? "," : "", e.effectID);
+				out.Format("\"magnitude\":%d,\"area\":%d,\"duration\":%d,", e.magnitude, e.area, e.duration);
+				out.Format("\"range\":%d,\"actorValue\":%d}", e.range, e.actorValue);
+			}
+			out.Append("]}\n");
+		}
+	}
+
+	return out.Flush();
+}
+
+bool SpellSnapshot::Read(std::string_view text, Format format, size_t& errorLine)
+{
+	errorLine = 0;
+
+	while (!text.empty()) {
+		errorLine++;
+
+		const size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+		if (line.ends_with('\r')) line.remove_suffix(1);
+		if (line.empty()) continue;
+		if (format == Format::Csv && errorLine == 1 && line.starts_with("FormID,")) continue;
+
+		const bool parsed = format == Format::Csv ? ReadCsvLine(line, *this) : ReadJsonLine(line, *this);
+		if (!parsed) return false;
+	}
+
+	errorLine = 0;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SpellEffect.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Copy of a spell list made on the game thread. Holds no game pointers: names are copied
+// into one string arena and effects into one flat array, so the snapshot can be handed to
+// another thread and outlive the frame it was taken in.
+struct SpellSnapshot
+{
+	struct Spell
+	{
+		uint32_t formID;
+		int32_t spellType;
+		int32_t cost;
+		uint32_t flags;
+		uint32_t nameOffset;	// Into names
+		uint32_t nameLength;
+		uint32_t effectOffset;	// Into effects
+		uint32_t effectCount;
+	};
+
+	std::vector<Spell> spells;
+	std::vector<SpellEffect> effects;
+	std::string names;
+
+	void Clear();
+
+	std::string_view GetName(const Spell& spell) const {
+		return std::string_view(names).substr(spell.nameOffset, spell.nameLength);
+	}
+
+	const SpellEffect* GetEffects(const Spell& spell) const {
+		return effects.data() + spell.effectOffset;
+	}
+
+	enum class Format
+	{
+		Csv,
+		JsonLines,
+	};
+
+	static Format ParseFormat(std::string_view name);
+	static const char* GetExtension(Format format);
+
+	// Streams the snapshot through a fixed-size buffer. Returns false on a write error.
+	// CSV names have line breaks replaced by spaces, JSON names escape every byte from 0x80
+	bool Write(FILE* file, Format format) const;
+
+	// Parses text produced by Write, appending to the snapshot. Returns false and sets errorLine
+	// (1-based) on the first malformed line
+	bool Read(std::string_view text, Format format, size_t& errorLine);
+};
@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "SpellStats.h"
+#include "ConfigFile.h"
+#include "SaveProfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	// On-disk layout: header followed by `count` packed entries
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t count;
+		uint32_t reserved;
+		int64_t trackingSince;
+		int64_t playTime;		// Version 2, version 1 stored Unix times
+	};
+
+	constexpr char kMagic[4] = { 'D', 'S', 'S', 'T' };
+	constexpr uint32_t kVersion = 2;
+	constexpr size_t kHeaderSizeV1 = offsetof(FileHeader, playTime);
+
+	struct Slot
+	{
+		std::atomic<uint32_t> formID{ 0 };
+		std::atomic<uint32_t> castCount{ 0 };
+		std::atomic<int64_t> lastUsed{ 0 };
+	};
+}
+
+static std::unique_ptr<Slot[]> s_Slots;
+static uint32_t s_Capacity = 0;
+static uint32_t s_Shift = 0;
+static int64_t s_TrackingSince = 0;
+static int64_t s_PlayTimeLoaded = 0;
+static const auto s_SessionStart = std::chrono::steady_clock::now();
+static std::atomic<uint32_t> s_Dropped{ 0 };
+
+void SpellStats::Init()
+{
+	if (s_Slots) return;
+
+	// Round up to a power of two so the probe sequence can use a shift and mask
+	const int requested = ConfigFile::GetInt("iSpellStatsCapacity", 4096);
+	s_Capacity = std::bit_ceil(static_cast<uint32_t>(std::max(requested, 64)));
+	s_Shift = 32 - std::countr_zero(s_Capacity);
+	s_Slots = std::make_unique<Slot[]>(s_Capacity);
+
+	Load();
+
+	std::thread(WriterThread).detach();
+	printf("[Delete Spells] Spell usage tracking enabled (%u slots)\n", s_Capacity);
+}
+
+bool SpellStats::IsEnabled()
+{
+	return s_Slots != nullptr;
+}
+
+int64_t SpellStats::Now()
+{
+	return s_PlayTimeLoaded + std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - s_SessionStart).count();
+}
+
+static Slot* FindSlot(uint32_t formID, bool insert)
+{
+	if (!s_Slots || !formID) return nullptr;
+
+	// Fibonacci hashing spreads the mostly sequential FormIDs of a plugin
+	uint32_t index = (formID * 0x9E3779B1u) >> s_Shift;
+	const uint32_t mask = s_Capacity - 1;
+
+	for (uint32_t probe = 0; probe < s_Capacity; ++probe, index = (index + 1) & mask) {
+		Slot& slot = s_Slots[index];
+		uint32_t current = slot.formID.load(std::memory_order_acquire);
+
+		if (current == formID) return &slot;
+
+		if (current == 0) {
+			if (!insert) return nullptr;
+
+			// Claim the empty slot; if another thread won the race, check whether it stored our ID
+			if (slot.formID.compare_exchange_strong(current, formID, std::memory_order_acq_rel) || current == formID)
+				return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+void SpellStats::RecordCast(uint32_t formID)
+{
+	Slot* slot = FindSlot(formID, true);
+	if (!slot) {
+		s_Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	slot->castCount.fetch_add(1, std::memory_order_relaxed);
+	slot->lastUsed.store(Now(), std::memory_order_relaxed);
+}
+
+std::optional<SpellStats::Entry> SpellStats::Get(uint32_t formID)
+{
+	const Slot* slot = FindSlot(formID, false);
+	if (!slot) return std::nullopt;
+
+	return Entry{
+		formID,
+		slot->castCount.load(std::memory_order_relaxed),
+		slot->lastUsed.load(std::memory_order_relaxed)
+	};
+}
+
+std::vector<SpellStats::Entry> SpellStats::Snapshot()
+{
+	std::vector<Entry> entries;
+	if (!s_Slots) return entries;
+
+	for (uint32_t i = 0; i < s_Capacity; ++i) {
+		const Slot& slot = s_Slots[i];
+		const uint32_t formID = slot.formID.load(std::memory_order_acquire);
+		if (!formID) continue;
+
+		entries.push_back({ formID, slot.castCount.load(std::memory_order_relaxed), slot.lastUsed.load(std::memory_order_relaxed) });
+	}
+
+	return entries;
+}
+
+bool SpellStats::IsUnusedFor(uint32_t formID, int hours)
+{
+	if (!s_Slots) return false;
+
+	const int64_t cutoff = Now() - static_cast<int64_t>(hours) * 60 * 60;
+	const auto entry = Get(formID);
+	const int64_t lastUsed = (entry && entry->lastUsed) ? entry->lastUsed : s_TrackingSince;
+	return lastUsed < cutoff;
+}
+
+void SpellStats::Load()
+{
+	const std::string path = SaveProfile::GetDataPath(".stats");
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return;
+
+	FileHeader header{};
+	if (!file.read(reinterpret_cast<char*>(&header), kHeaderSizeV1) ||
+		memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version < 1 || header.version > kVersion ||
+		(header.version >= 2 && !file.read(reinterpret_cast<char*>(&header.playTime), sizeof(header.playTime)))) {
+		printf("[Delete Spells] Ignoring invalid spell usage file: %s\n", path.c_str());
+		return;
+	}
+
+	// Version 1 times were wall clock and cannot be converted, only the counts are kept
+	const bool hasPlayTime = header.version >= 2;
+	if (hasPlayTime) {
+		s_TrackingSince = header.trackingSince;
+		s_PlayTimeLoaded = header.playTime;
+	}
+
+	uint32_t loaded = 0;
+	Entry entry{};
+	for (uint32_t i = 0; i < header.count && file.read(reinterpret_cast<char*>(&entry), sizeof(entry)); ++i) {
+		Slot* slot = FindSlot(entry.formID, true);
+		if (!slot) break;
+
+		slot->castCount.store(entry.castCount, std::memory_order_relaxed);
+		slot->lastUsed.store(hasPlayTime ? entry.lastUsed : 0, std::memory_order_relaxed);
+		++loaded;
+	}
+
+	printf("[Delete Spells] Loaded usage stats for %u spells\n", loaded);
+}
+
+void SpellStats::Save()
+{
+	const auto entries = Snapshot();
+	const std::string path = SaveProfile::GetDataPath(".stats");
+	const std::string tempPath = path + ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			printf("[Delete Spells] Failed to write spell usage file: %s\n", tempPath.c_str());
+			return;
+		}
+
+		FileHeader header{};
+		memcpy(header.magic, kMagic, sizeof(kMagic));
+		header.version = kVersion;
+		header.count = static_cast<uint32_t>(entries.size());
+		header.trackingSince = s_TrackingSince;
+		header.playTime = Now();
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		if (!file) {
+			printf("[Delete Spells] Failed to write spell usage file: %s\n", tempPath.c_str());
+			return;
+		}
+	}
+
+	// Replace atomically so a crash mid-write keeps the previous snapshot
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		printf("[Delete Spells] Failed to replace spell usage file: %s\n", ec.message().c_str());
+	}
+
+	if (const uint32_t dropped = s_Dropped.exchange(0)) {
+		printf("[Delete Spells] Spell usage table full, %u casts were not recorded (raise iSpellStatsCapacity)\n", dropped);
+	}
+}
+
+void SpellStats::WriterThread()
+{
+	const auto interval = std::chrono::seconds(std::max(ConfigFile::GetInt("iSpellStatsSaveInterval", 60), 5));
+
+	// The play clock moves every interval, so there is always something to save
+	while (true) {
+		std::this_thread::sleep_for(interval);
+		Save();
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Per-FormID cast counters for the player's spells.
+// RecordCast runs on the spell-cast path, so the table has a fixed capacity and
+// atomic slots: no locks and no allocation after Init.
+// Times are play time: seconds the game has been running with this profile, saved with the
+// counters, so time away from the game never makes a spell unused. The clock starts when the
+// plugin loads and also runs in menus and while paused.
+// Counters are kept per sSaveProfile, not per save game, and written every iSpellStatsSaveInterval
+// seconds. Casts since the last write are lost when the game exits.
+class SpellStats
+{
+public:
+	struct Entry
+	{
+		uint32_t formID;
+		uint32_t castCount;
+		int64_t lastUsed; // Play time, seconds
+	};
+
+	static void Init();
+
+	// False until Init, i.e. while sCastSpellSignature is not set
+	static bool IsEnabled();
+
+	// Hot path
+	static void RecordCast(uint32_t formID);
+
+	static std::optional<Entry> Get(uint32_t formID);
+	static std::vector<Entry> Snapshot();
+
+	// Returns true if the spell has not been cast in the last `hours` hours of play
+	static bool IsUnusedFor(uint32_t formID, int hours);
+
+	// Current play time, seconds
+	static int64_t Now();
+
+private:
+	static void Load();
+	static void Save();
+	static void WriterThread();
+};
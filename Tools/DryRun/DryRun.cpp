@@ -0,0 +1,385 @@
+#include "pch.h"
+#include "ConfigFile.h"
+#include "PruneRules.h"
+#include "SpellSnapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Offline dry run of a DeleteSpells.conf over exported spell snapshots (iExportKey).
+// The config is compiled with the plugin's own parser and rule code, then every snapshot is
+// evaluated the way the plugin would treat the player's spell list, with no game present.
+// Only ActorRemovalRules remove spells the player already has. AutoPruneRules apply when a spell
+// is added, so their matches are reported apart, as what would happen if the spell were acquired.
+//
+// Usage: DeleteSpellsDryRun -c <DeleteSpells.conf> [-j threads] [-o report] [--summary] <snapshot files or directories>...
+
+namespace
+{
+	enum class Reason : uint8_t
+	{
+		AutoPruneReject,	// AutoPruneRules action=reject, on acquisition
+		AutoPruneQueue,		// AutoPruneRules action=queue, on acquisition
+		ActorCleanup,		// Matched ActorRemovalRules with bActorCleanupIncludePlayer
+		Blacklisted,		// Matched a rule but kept by BlacklistedSpells
+	};
+
+	const char* ReasonName(Reason reason)
+	{
+		switch (reason) {
+		case Reason::AutoPruneReject: return "reject on add";
+		case Reason::AutoPruneQueue: return "queue on add";
+		case Reason::ActorCleanup: return "ActorRemovalRules";
+		default: return "blacklisted";
+		}
+	}
+
+	// Compiled config, read only once the workers start
+	struct Config
+	{
+		PruneRules autoPruneRules;
+		PruneRules actorRemovalRules;
+		bool actorCleanupIncludePlayer = false;
+		const std::unordered_set<uint32_t>* blacklist = nullptr;
+	};
+
+	struct Result
+	{
+		bool loaded = false;
+		size_t spells = 0;
+		size_t bytes = 0;
+		size_t removed = 0;
+		size_t onAcquisition = 0;
+		size_t kept = 0;
+		std::string diff;
+	};
+
+	// Name is taken from the first snapshot matching the spell, so the report does not depend on scheduling
+	struct Removal
+	{
+		uint32_t snapshots = 0;
+		size_t firstSnapshot = SIZE_MAX;
+		std::string name;
+	};
+
+	// Per worker totals, merged after the run so the workers share nothing but the next index
+	struct Totals
+	{
+		size_t spells = 0;
+		size_t bytes = 0;
+		size_t byReason[3] = {};	// Indexed by Reason, blacklisted spells are counted in kept
+		size_t kept = 0;
+		std::unordered_map<uint32_t, Removal> removals;
+		std::unordered_map<uint32_t, Removal> acquisitions;
+	};
+
+	struct Options
+	{
+		std::string configPath;
+		std::string reportPath;
+		unsigned threads = 0;
+		bool summaryOnly = false;
+		std::vector<std::filesystem::path> inputs;
+	};
+
+	bool ReadFile(const std::filesystem::path& path, std::string& out)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) return false;
+
+		out.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		return static_cast<bool>(file.read(out.data(), static_cast<std::streamsize>(out.size())));
+	}
+
+	bool IsSnapshotFile(const std::filesystem::path& path)
+	{
+		const auto extension = path.extension();
+		return extension == ".csv" || extension == ".jsonl";
+	}
+
+	void AppendDiffLine(std::string& diff, char marker, const SpellSnapshot& snapshot, const SpellSnapshot::Spell& spell, Reason reason)
+	{
+		char line[64];
+		snprintf(line, sizeof(line), "%c 0x%08X %-18s ", marker, spell.formID, ReasonName(reason));
+		diff.append(line);
+		diff.append(snapshot.GetName(spell));
+		diff.push_back('\n');
+	}
+
+	void Count(std::unordered_map<uint32_t, Removal>& removals, size_t index, const SpellSnapshot& snapshot, const SpellSnapshot::Spell& spell)
+	{
+		Removal& removal = removals[spell.formID];
+		if (removal.snapshots++ == 0) {
+			removal.firstSnapshot = index;
+			removal.name = snapshot.GetName(spell);
+		}
+	}
+
+	// Mirrors the plugin: the actor cleanup command removes spells the player has, the auto prune hook only
+	// sees spells being added. Both always keep blacklisted spells, whatever bProtectSpells says.
+	// A spell matching both is reported as removed, since the cleanup takes it before any acquisition
+	void Evaluate(const Config& config, size_t index, const std::filesystem::path& path, const SpellSnapshot& snapshot, Result& result, Totals& totals, bool summaryOnly)
+	{
+		const auto& blacklist = *config.blacklist;
+
+		for (const SpellSnapshot::Spell& spell : snapshot.spells) {
+			const auto flags = static_cast<uint8_t>(spell.flags);
+
+			Reason reason;
+			if (config.actorCleanupIncludePlayer && config.actorRemovalRules.Match(spell.formID, spell.spellType, flags) != PruneRules::Action::None) {
+				reason = Reason::ActorCleanup;
+			}
+			else {
+				const auto action = config.autoPruneRules.Match(spell.formID, spell.spellType, flags);
+				if (action == PruneRules::Action::None) continue;
+				reason = action == PruneRules::Action::Reject ? Reason::AutoPruneReject : Reason::AutoPruneQueue;
+			}
+
+			if (blacklist.contains(spell.formID)) {
+				result.kept++;
+				totals.kept++;
+				if (!summaryOnly) AppendDiffLine(result.diff, '=', snapshot, spell, Reason::Blacklisted);
+				continue;
+			}
+
+			totals.byReason[static_cast<size_t>(reason)]++;
+			if (reason == Reason::ActorCleanup) {
+				result.removed++;
+				Count(totals.removals, index, snapshot, spell);
+				if (!summaryOnly) AppendDiffLine(result.diff, '-', snapshot, spell, reason);
+			}
+			else {
+				result.onAcquisition++;
+				Count(totals.acquisitions, index, snapshot, spell);
+				if (!summaryOnly) AppendDiffLine(result.diff, '~', snapshot, spell, reason);
+			}
+		}
+
+		if (!summaryOnly) {
+			char header[96];
+			snprintf(header, sizeof(header), " (%zu spells, %zu removed, %zu pruned on acquisition, %zu kept)\n",
+				result.spells, result.removed, result.onAcquisition, result.kept);
+			result.diff.insert(0, "--- " + path.string() + header);
+		}
+	}
+
+	void Merge(std::unordered_map<uint32_t, Removal>& merged, std::unordered_map<uint32_t, Removal>& worker)
+	{
+		for (auto& [formID, removal] : worker) {
+			Removal& entry = merged[formID];
+			entry.snapshots += removal.snapshots;
+			if (removal.firstSnapshot < entry.firstSnapshot) {
+				entry.firstSnapshot = removal.firstSnapshot;
+				entry.name = std::move(removal.name);
+			}
+		}
+	}
+
+	// The 20 spells matched in the most snapshots
+	void PrintMostMatched(FILE* report, const std::unordered_map<uint32_t, Removal>& removals, const char* verb)
+	{
+		std::vector<std::pair<uint32_t, const Removal*>> most;
+		for (const auto& [formID, removal] : removals)
+			most.emplace_back(formID, &removal);
+		std::ranges::sort(most, [](const auto& a, const auto& b) {
+			return a.second->snapshots != b.second->snapshots ? a.second->snapshots > b.second->snapshots : a.first < b.first;
+			});
+		most.resize(std::min<size_t>(most.size(), 20));
+
+		for (const auto& [formID, removal] : most)
+			fprintf(report, "  0x%08X %s %u snapshots  %s\n", formID, verb, removal->snapshots, removal->name.c_str());
+	}
+
+	void RunWorker(const Config& config, const Options& options, const std::vector<std::filesystem::path>& files,
+		std::vector<Result>& results, std::atomic<size_t>& next, Totals& totals)
+	{
+		// Reused across snapshots so a worker allocates only when a snapshot outgrows the last one
+		SpellSnapshot snapshot;
+		std::string text;
+
+		for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < files.size(); i = next.fetch_add(1, std::memory_order_relaxed)) {
+			Result& result = results[i];
+			const auto& path = files[i];
+
+			snapshot.Clear();
+			size_t errorLine = 0;
+			if (!ReadFile(path, text)) {
+				result.diff = "!!! " + path.string() + ": could not read file\n";
+				continue;
+			}
+			const auto format = path.extension() == ".jsonl" ? SpellSnapshot::Format::JsonLines : SpellSnapshot::Format::Csv;
+			if (!snapshot.Read(text, format, errorLine)) {
+				result.diff = "!!! " + path.string() + ": malformed line " + std::to_string(errorLine) + "\n";
+				continue;
+			}
+
+			result.loaded = true;
+			result.spells = snapshot.spells.size();
+			result.bytes = text.size();
+			totals.spells += result.spells;
+			totals.bytes += result.bytes;
+
+			Evaluate(config, i, path, snapshot, result, totals, options.summaryOnly);
+		}
+	}
+
+	bool ParseArguments(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i) {
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if ((arg == "-c" || arg == "--config") && hasValue)
+				options.configPath = argv[++i];
+			else if ((arg == "-o" || arg == "--output") && hasValue)
+				options.reportPath = argv[++i];
+			else if ((arg == "-j" || arg == "--threads") && hasValue)
+				options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+			else if (arg == "--summary")
+				options.summaryOnly = true;
+			else if (!arg.starts_with("-"))
+				options.inputs.emplace_back(arg);
+			else
+				return false;
+		}
+		return !options.configPath.empty() && !options.inputs.empty();
+	}
+
+	// Directories are searched recursively. Sorted so reports of the same inputs diff cleanly
+	std::vector<std::filesystem::path> CollectFiles(const std::vector<std::filesystem::path>& inputs)
+	{
+		std::vector<std::filesystem::path> files;
+		std::error_code error;
+
+		for (const auto& input : inputs) {
+			if (!std::filesystem::is_directory(input, error)) {
+				files.push_back(input);
+				continue;
+			}
+
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error)) {
+				if (entry.is_regular_file(error) && IsSnapshotFile(entry.path()))
+					files.push_back(entry.path());
+			}
+		}
+
+		std::ranges::sort(files);
+		return files;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseArguments(argc, argv, options)) {
+		printf("Usage: %s -c <DeleteSpells.conf> [-j threads] [-o report] [--summary] <snapshot files or directories>...\n", argv[0]);
+		return 2;
+	}
+
+	if (!ConfigFile::InitFromFile(options.configPath)) {
+		printf("[Dry Run] Config not found: %s\n", options.configPath.c_str());
+		return 1;
+	}
+
+	Config config;
+	config.autoPruneRules.Compile(ConfigFile::GetArray("AutoPruneRules"));
+	config.actorRemovalRules.Compile(ConfigFile::GetArray("ActorRemovalRules"));
+	config.actorCleanupIncludePlayer = ConfigFile::GetBool("bActorCleanupIncludePlayer", false);
+	config.blacklist = &ConfigFile::GetBlacklistedSpells();
+
+	printf("[Dry Run] %zu auto prune rules, %zu actor removal rules, %zu blacklisted spells\n",
+		config.autoPruneRules.GetRuleCount(),
+		config.actorRemovalRules.GetRuleCount(),
+		config.blacklist->size()
+	);
+
+	const auto files = CollectFiles(options.inputs);
+	if (files.empty()) {
+		printf("[Dry Run] No snapshot files found\n");
+		return 1;
+	}
+
+	const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	const size_t threadCount = std::clamp<size_t>(options.threads ? options.threads : hardwareThreads, 1, files.size());
+
+	std::vector<Result> results(files.size());
+	std::vector<Totals> totals(threadCount);
+	std::atomic<size_t> next = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (size_t i = 1; i < threadCount; ++i)
+		workers.emplace_back(RunWorker, std::cref(config), std::cref(options), std::cref(files), std::ref(results), std::ref(next), std::ref(totals[i]));
+	RunWorker(config, options, files, results, next, totals[0]);
+	for (auto& worker : workers)
+		worker.join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Merge the per worker totals
+	Totals total;
+	for (Totals& worker : totals) {
+		total.spells += worker.spells;
+		total.bytes += worker.bytes;
+		for (size_t i = 0; i < std::size(total.byReason); ++i)
+			total.byReason[i] += worker.byReason[i];
+		total.kept += worker.kept;
+		Merge(total.removals, worker.removals);
+		Merge(total.acquisitions, worker.acquisitions);
+	}
+
+	FILE* report = stdout;
+	if (!options.reportPath.empty()) {
+		report = fopen(options.reportPath.c_str(), "wb");
+		if (!report) {
+			printf("[Dry Run] Could not open %s for writing\n", options.reportPath.c_str());
+			return 1;
+		}
+	}
+
+	size_t loaded = 0;
+	size_t affected = 0;
+	for (const Result& result : results) {
+		if (!result.diff.empty())
+			fwrite(result.diff.data(), 1, result.diff.size(), report);
+		loaded += result.loaded;
+		affected += result.removed ? 1 : 0;
+	}
+
+	fprintf(report, "=== Summary\n");
+	fprintf(report, "Snapshots: %zu loaded, %zu failed, %zu with removals\n", loaded, files.size() - loaded, affected);
+	fprintf(report, "Spells: %zu scanned, %zu removed by ActorRemovalRules, %zu kept by the blacklist\n",
+		total.spells, total.byReason[static_cast<size_t>(Reason::ActorCleanup)], total.kept);
+	PrintMostMatched(report, total.removals, "removed from");
+	fprintf(report, "On acquisition (AutoPruneRules, spells already held are not removed): %zu would be rejected, %zu would be queued\n",
+		total.byReason[static_cast<size_t>(Reason::AutoPruneReject)], total.byReason[static_cast<size_t>(Reason::AutoPruneQueue)]);
+	PrintMostMatched(report, total.acquisitions, "pruned on acquisition in");
+
+	if (report != stdout)
+		fclose(report);
+
+	// Throughput covers reading, parsing and evaluating, not writing the report
+	printf("[Dry Run] %zu snapshots on %zu threads in %.3f s: %.1f snapshots/s, %.0f spells/s, %.1f MB/s\n",
+		files.size(),
+		threadCount,
+		seconds,
+		static_cast<double>(files.size()) / seconds,
+		static_cast<double>(total.spells) / seconds,
+		static_cast<double>(total.bytes) / (1024.0 * 1024.0) / seconds
+	);
+
+	return loaded == files.size() ? 0 : 1;
+}
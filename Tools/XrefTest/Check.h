@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal check macro shared by the test executables. Failures are counted, not fatal,
+// so one run reports every broken check
+inline int g_Failures = 0;
+
+inline void Check(bool condition, const char* expression, const char* file, int line)
+{
+	if (condition) return;
+	printf("FAILED %s:%d: %s\n", file, line, expression);
+	g_Failures++;
+}
+
+#define CHECK(expression) Check((expression), #expression, __FILE__, __LINE__)
+
+inline int ReportChecks()
+{
+	if (g_Failures) {
+		printf("%d checks failed\n", g_Failures);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,143 @@
+#include "pch.h"
+#include "Check.h"
+#include "PruneRules.h"
+
+#include <cstdint>
+
+// Checks the interval compilation of PruneRules against rules whose expected matches can be read
+// straight off the rule text, run by CTest.
+
+namespace
+{
+	using Action = PruneRules::Action;
+
+	constexpr int kSpell = 0;
+	constexpr int kPower = 2;
+	constexpr int kAbility = 4;
+
+	void TestEmpty()
+	{
+		PruneRules rules;
+		rules.Compile({});
+
+		CHECK(rules.IsEmpty());
+		CHECK(rules.GetRuleCount() == 0);
+		CHECK(rules.Match(0x01000000, kSpell, 0) == Action::None);
+	}
+
+	void TestInvalidLines()
+	{
+		PruneRules rules;
+		rules.Compile({
+			"mod=0x0A action=reject",
+			"bogus",
+			"action=reject",				// No filter would match every spell
+			"formid=0x20-0x10",				// Reversed range
+			"mod=0x100",
+			"type=spell|nothing",
+			"flags=0x100",
+			"mod=0x0B action=delete",
+		});
+
+		CHECK(rules.GetRuleCount() == 1);
+		CHECK(rules.Match(0x0A000001, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0x0B000001, kSpell, 0) == Action::None);
+	}
+
+	// Overlapping ranges split into elementary intervals, each keeping every rule that covers it
+	void TestOverlappingRanges()
+	{
+		PruneRules rules;
+		rules.Compile({
+			"formid=0x100-0x200 action=reject",
+			"formid=0x180-0x300 action=queue",
+			"formid=0x250-0x260 type=ability action=reject",
+		});
+
+		CHECK(rules.Match(0x0FF, kSpell, 0) == Action::None);
+		CHECK(rules.Match(0x100, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0x17F, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0x180, kSpell, 0) == Action::Reject);	// Both cover it, the first wins
+		CHECK(rules.Match(0x200, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0x201, kSpell, 0) == Action::Queue);
+		CHECK(rules.Match(0x250, kAbility, 0) == Action::Queue);	// Rule 2 comes before rule 3
+		CHECK(rules.Match(0x300, kSpell, 0) == Action::Queue);
+		CHECK(rules.Match(0x301, kSpell, 0) == Action::None);
+	}
+
+	// The first rule whose type and flags fit wins, later rules still apply to the rest
+	void TestFirstMatchWins()
+	{
+		PruneRules rules;
+		rules.Compile({
+			"mod=0x0A type=power action=reject",
+			"mod=0x0A flags=0x04 action=reject",
+			"mod=0x0A action=queue",
+		});
+
+		CHECK(rules.Match(0x0A000001, kPower, 0) == Action::Reject);
+		CHECK(rules.Match(0x0A000001, kSpell, 0x04) == Action::Reject);
+		CHECK(rules.Match(0x0A000001, kSpell, 0x00) == Action::Queue);
+		CHECK(rules.Match(0x0B000001, kPower, 0x04) == Action::None);
+	}
+
+	void TestTypeAndFlagMasks()
+	{
+		PruneRules rules;
+		rules.Compile({
+			"type=spell|2 action=reject",		// Names and numbers can be mixed
+			"type=ABILITY flags=0x05 action=queue",
+		});
+
+		CHECK(rules.Match(0x01000000, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0x01000000, kPower, 0) == Action::Reject);
+		CHECK(rules.Match(0x01000000, 3, 0) == Action::None);
+		CHECK(rules.Match(0x01000000, kAbility, 0x05) == Action::Queue);
+		CHECK(rules.Match(0x01000000, kAbility, 0x0F) == Action::Queue);
+		CHECK(rules.Match(0x01000000, kAbility, 0x04) == Action::None);	// Every flag bit is required
+		CHECK(rules.Match(0x01000000, -1, 0xFF) == Action::None);
+		CHECK(rules.Match(0x01000000, 9, 0xFF) == Action::None);
+
+		uint8_t mask = 0;
+		CHECK(PruneRules::ParseSpellTypes("Spell|POWER", mask) && mask == 0x05);
+		CHECK(PruneRules::ParseSpellTypes("7", mask) && mask == 0x80);
+		CHECK(!PruneRules::ParseSpellTypes("8", mask));
+		CHECK(!PruneRules::ParseSpellTypes("", mask));
+	}
+
+	// A range ending at 0xFFFFFFFF has no interval after it, and must not wrap around to 0
+	void TestUpperEdge()
+	{
+		PruneRules rules;
+		rules.Compile({
+			"formid=0xFFFFFF00-0xFFFFFFFF action=reject",
+			"mod=0xFF type=ability action=queue",
+		});
+
+		CHECK(rules.Match(0xFFFFFFFF, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0xFFFFFF00, kSpell, 0) == Action::Reject);
+		CHECK(rules.Match(0xFFFFFEFF, kSpell, 0) == Action::None);
+		CHECK(rules.Match(0xFFFFFEFF, kAbility, 0) == Action::Queue);
+		CHECK(rules.Match(0xFF000000, kAbility, 0) == Action::Queue);
+		CHECK(rules.Match(0xFEFFFFFF, kAbility, 0) == Action::None);
+		CHECK(rules.Match(0x00000000, kSpell, 0) == Action::None);
+
+		PruneRules single;
+		single.Compile({ "formid=0xFFFFFFFF" });
+		CHECK(single.Match(0xFFFFFFFF, kSpell, 0) == Action::Queue);
+		CHECK(single.Match(0xFFFFFFFE, kSpell, 0) == Action::None);
+		CHECK(single.Match(0, kSpell, 0) == Action::None);
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestInvalidLines();
+	TestOverlappingRanges();
+	TestFirstMatchWins();
+	TestTypeAndFlagMasks();
+	TestUpperEdge();
+
+	return ReportChecks();
+}
@@ -0,0 +1,177 @@
+#include "pch.h"
+#include "Check.h"
+#include "SpellSnapshot.h"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Checks that SpellSnapshot::Read parses what Write produces in both formats, run by CTest.
+// Names cover the characters each format has to escape.
+
+namespace
+{
+	using Format = SpellSnapshot::Format;
+
+	void AddSpell(SpellSnapshot& snapshot, uint32_t formID, std::string_view name, int32_t type, int32_t cost, uint32_t flags,
+		std::initializer_list<SpellEffect> effects)
+	{
+		SpellSnapshot::Spell spell{};
+		spell.formID = formID;
+		spell.spellType = type;
+		spell.cost = cost;
+		spell.flags = flags;
+		spell.nameOffset = static_cast<uint32_t>(snapshot.names.size());
+		spell.nameLength = static_cast<uint32_t>(name.size());
+		spell.effectOffset = static_cast<uint32_t>(snapshot.effects.size());
+		spell.effectCount = static_cast<uint32_t>(effects.size());
+
+		snapshot.names.append(name);
+		snapshot.effects.insert(snapshot.effects.end(), effects);
+		snapshot.spells.push_back(spell);
+	}
+
+	SpellSnapshot MakeSnapshot()
+	{
+		// Script and flags are not part of the snapshot formats, so they stay 0
+		SpellSnapshot snapshot;
+		AddSpell(snapshot, 0xFF000801, "Fire \"Big\" Bolt, \\ ok", 0, 120, 0x04, {
+			{ 0x53455246, 25, 10, 1, 2, -1, 0, 0 },
+			{ 0x5447414D, 5, 0, 30, 0, 12, 0, 0 },
+		});
+		AddSpell(snapshot, 0x0A000010, "Caf\xE9 \xFF\tTab", 2, -1, 0xFF, {
+			{ 0x4C414548, 10, 0, 0, 0, 0, 0, 0 },
+		});
+		AddSpell(snapshot, 0x00000136, "", 4, 0, 0, {});
+		return snapshot;
+	}
+
+	std::string WriteToString(const SpellSnapshot& snapshot, Format format)
+	{
+		FILE* file = tmpfile();
+		CHECK(file != nullptr);
+		if (!file) return {};
+
+		CHECK(snapshot.Write(file, format));
+
+		std::string text(static_cast<size_t>(ftell(file)), '\0');
+		rewind(file);
+		CHECK(fread(text.data(), 1, text.size(), file) == text.size());
+		fclose(file);
+		return text;
+	}
+
+	// Everything but the names, which differ by format
+	bool SameSpells(const SpellSnapshot& a, const SpellSnapshot& b)
+	{
+		if (a.spells.size() != b.spells.size()) return false;
+
+		for (size_t i = 0; i < a.spells.size(); ++i) {
+			const auto& x = a.spells[i];
+			const auto& y = b.spells[i];
+			if (x.formID != y.formID || x.spellType != y.spellType || x.cost != y.cost || x.flags != y.flags || x.effectCount != y.effectCount)
+				return false;
+
+			for (uint32_t e = 0; e < x.effectCount; ++e) {
+				if (a.GetEffects(x)[e] != b.GetEffects(y)[e]) return false;
+			}
+		}
+		return true;
+	}
+
+	void TestCsvRoundTrip()
+	{
+		const SpellSnapshot original = MakeSnapshot();
+		const std::string text = WriteToString(original, Format::Csv);
+
+		SpellSnapshot read;
+		size_t errorLine = 0;
+		CHECK(read.Read(text, Format::Csv, errorLine));
+		CHECK(errorLine == 0);
+		CHECK(SameSpells(original, read));
+
+		for (size_t i = 0; i < original.spells.size() && i < read.spells.size(); ++i)
+			CHECK(read.GetName(read.spells[i]) == original.GetName(original.spells[i]));
+	}
+
+	// Line breaks would split the record, so the writer turns them into spaces
+	void TestCsvLineBreaks()
+	{
+		SpellSnapshot original;
+		AddSpell(original, 0xFF000001, "Two\r\nLines\nHere", 0, 1, 0, {});
+
+		const std::string text = WriteToString(original, Format::Csv);
+		CHECK(text.find("\"Two  Lines Here\"") != std::string::npos);
+
+		SpellSnapshot read;
+		size_t errorLine = 0;
+		CHECK(read.Read(text, Format::Csv, errorLine));
+		CHECK(read.spells.size() == 1 && read.GetName(read.spells[0]) == "Two  Lines Here");
+	}
+
+	void TestJsonRoundTrip()
+	{
+		SpellSnapshot original = MakeSnapshot();
+		AddSpell(original, 0xFF000002, "Line\r\nBreak", 0, 1, 0, {});
+		const std::string text = WriteToString(original, Format::JsonLines);
+
+		// Bytes from 0x80 are escaped, so the output is plain ASCII
+		bool ascii = true;
+		for (const char c : text) ascii &= static_cast<unsigned char>(c) < 0x80;
+		CHECK(ascii);
+		CHECK(text.find("Caf\\u00E9 \\u00FF\\tTab") != std::string::npos);
+
+		SpellSnapshot read;
+		size_t errorLine = 0;
+		CHECK(read.Read(text, Format::JsonLines, errorLine));
+		CHECK(errorLine == 0);
+		CHECK(SameSpells(original, read));
+		CHECK(read.names == original.names);
+	}
+
+	// Read appends, so a reused snapshot has to be cleared between files
+	void TestReadAppends()
+	{
+		const SpellSnapshot original = MakeSnapshot();
+		const std::string text = WriteToString(original, Format::JsonLines);
+
+		SpellSnapshot read;
+		size_t errorLine = 0;
+		CHECK(read.Read(text, Format::JsonLines, errorLine));
+		CHECK(read.Read(text, Format::JsonLines, errorLine));
+		CHECK(read.spells.size() == 2 * original.spells.size());
+		CHECK(read.GetName(read.spells.back()) == original.GetName(original.spells.back()));
+
+		read.Clear();
+		CHECK(read.spells.empty() && read.effects.empty() && read.names.empty());
+	}
+
+	void TestMalformed()
+	{
+		SpellSnapshot read;
+		size_t errorLine = 0;
+
+		CHECK(!read.Read("FormID,Name,Type,Cost,Flags,Effects\n0x01,\"A\",0,1,0x00,\n0x02,\"B\",0,1\n", Format::Csv, errorLine));
+		CHECK(errorLine == 3);
+
+		CHECK(!read.Read("0x01,\"Unterminated,0,1,0x00,\n", Format::Csv, errorLine));
+		CHECK(errorLine == 1);
+
+		CHECK(!read.Read("{\"formId\":\"0x01\",\"name\":\"A\"}\n{\"formId\":\"0x02\",\"unknown\":1}\n", Format::JsonLines, errorLine));
+		CHECK(errorLine == 2);
+
+		CHECK(!read.Read("{\"formId\":\"0x01\",\"name\":\"\\u00\"}\n", Format::JsonLines, errorLine));
+		CHECK(errorLine == 1);
+	}
+}
+
+int main()
+{
+	TestCsvRoundTrip();
+	TestCsvLineBreaks();
+	TestJsonRoundTrip();
+	TestReadAppends();
+	TestMalformed();
+
+	return ReportChecks();
+}
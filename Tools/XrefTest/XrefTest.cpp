@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "Check.h"
+#include "XrefIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Checks XrefIndex against handcrafted x64 code, run by CTest.
+// Buffers only use nop, int3, ret, call rel32 and lea rax, [rip + disp32], so the expected
+// edges follow directly from where the instructions are placed.
+
+namespace
+{
+	constexpr uint32_t kBase = 0x1000;
+
+	class Code
+	{
+	public:
+		explicit Code(size_t size) : m_Bytes(size, 0x90) {}
+
+		// call rel32
+		void Call(size_t at, size_t target) {
+			m_Bytes[at] = 0xE8;
+			WriteRel32(at + 1, at + 5, target);
+		}
+
+		// lea rax, [rip + disp32]
+		void LeaRip(size_t at, size_t target) {
+			m_Bytes[at] = 0x48;
+			m_Bytes[at + 1] = 0x8D;
+			m_Bytes[at + 2] = 0x05;
+			WriteRel32(at + 3, at + 7, target);
+		}
+
+		// Raw displacement, for operands that must hold specific bytes
+		void CallRaw(size_t at, int32_t rel) {
+			m_Bytes[at] = 0xE8;
+			memcpy(&m_Bytes[at + 1], &rel, sizeof(rel));
+		}
+
+		void Padding(size_t at, size_t count) {
+			memset(&m_Bytes[at], 0xCC, count);
+		}
+
+		void Ret(size_t at) { m_Bytes[at] = 0xC3; }
+
+		std::span<const uint8_t> Bytes() const { return m_Bytes; }
+
+	private:
+		void WriteRel32(size_t at, size_t next, size_t target) {
+			const auto rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(next));
+			memcpy(&m_Bytes[at], &rel, sizeof(rel));
+		}
+
+		std::vector<uint8_t> m_Bytes;
+	};
+
+	bool SameEdges(std::span<const XrefIndex::Edge> a, std::span<const XrefIndex::Edge> b)
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (a[i].from != b[i].from || a[i].to != b[i].to) return false;
+		}
+		return true;
+	}
+
+	void TestLookups()
+	{
+		Code code(0x400);
+		code.Call(0x10, 0x200);
+		code.Call(0x40, 0x200);
+		code.Call(0x80, 0x300);
+		code.Call(0x250, 0x20);		// Backward
+		code.LeaRip(0x100, 0x5000);	// Data past the end of the code
+		code.LeaRip(0x120, 0x5000);
+		code.LeaRip(0x140, 0x6000);
+		code.Ret(0x3FF);
+
+		XrefIndex index;
+		index.Build(code.Bytes(), kBase, 1);
+
+		CHECK(index.GetCallCount() == 4);
+		CHECK(index.GetReferenceCount() == 3);
+
+		CHECK(index.GetCallee(kBase + 0x10) == kBase + 0x200);
+		CHECK(index.GetCallee(kBase + 0x250) == kBase + 0x20);
+		CHECK(index.GetCallee(kBase + 0x11) == 0);
+
+		CHECK(index.GetNextCallee(kBase + 0x30) == kBase + 0x200);
+		CHECK(index.GetNextCallee(kBase + 0x41, 0x3F) == 0);
+		CHECK(index.GetNextCallee(kBase + 0x41, 0x40) == kBase + 0x300);
+		CHECK(index.GetNextCallee(kBase + 0x260) == 0);
+
+		const auto callers = index.GetCallersOf(kBase + 0x200);
+		CHECK(callers.size() == 2);
+		CHECK(callers.size() == 2 && callers[0].from == kBase + 0x10 && callers[1].from == kBase + 0x40);
+		CHECK(index.GetCallersOf(kBase + 0x201).empty());
+
+		const auto references = index.GetReferencesTo(kBase + 0x5000);
+		CHECK(references.size() == 2);
+		CHECK(references.size() == 2 && references[0].from == kBase + 0x100 && references[1].from == kBase + 0x120);
+		CHECK(index.GetReferencesTo(kBase + 0x6000).size() == 1);
+		CHECK(index.GetReferencesTo(kBase + 0x200).empty());
+	}
+
+	// Splits the code so a chunk boundary lands inside a call whose operand decodes as more calls.
+	// The second chunk has to resync after the int3 padding instead of decoding the operand.
+	void TestChunkResync()
+	{
+		constexpr size_t kSize = 256 * 1024;
+		constexpr size_t kBoundary = 64 * 1024;	// 4 threads over 256 KB give 64 KB chunks
+
+		Code code(kSize);
+		code.CallRaw(kBoundary - 2, 0x00E8E8E8);	// Bytes E8 E8 E8 E8 00 across the boundary
+		code.Ret(kBoundary + 3);
+		code.Padding(kBoundary + 4, 12);
+		code.Call(kBoundary + 16, 0x100);
+		code.Call(3 * kBoundary + 8, 0x100);
+		code.Padding(2 * kBoundary - 8, 8);		// Padding right before the next boundary
+		code.LeaRip(2 * kBoundary, 0x100);
+
+		XrefIndex single;
+		single.Build(code.Bytes(), kBase, 1);
+
+		XrefIndex parallel;
+		parallel.Build(code.Bytes(), kBase, 4);
+
+		CHECK(single.GetCallCount() == 3);
+		CHECK(single.GetReferenceCount() == 1);
+		CHECK(parallel.GetCallCount() == 3);
+		CHECK(parallel.GetReferenceCount() == 1);
+
+		CHECK(parallel.GetCallee(kBase + kBoundary - 2) == kBase + kBoundary + 3 + 0x00E8E8E8);
+		CHECK(parallel.GetCallee(kBase + kBoundary - 1) == 0);
+		CHECK(parallel.GetCallee(kBase + kBoundary + 16) == kBase + 0x100);
+		CHECK(parallel.GetCallersOf(kBase + 0x100).size() == 2);
+		CHECK(parallel.GetReferencesTo(kBase + 0x100).size() == 1);
+
+		CHECK(SameEdges(single.GetCallersOf(kBase + 0x100), parallel.GetCallersOf(kBase + 0x100)));
+		CHECK(SameEdges(single.GetReferencesTo(kBase + 0x100), parallel.GetReferencesTo(kBase + 0x100)));
+	}
+
+	void TestSaveLoad()
+	{
+		Code code(0x200);
+		code.Call(0x10, 0x100);
+		code.Call(0x20, 0x100);
+		code.LeaRip(0x40, 0x800);
+
+		XrefIndex index;
+		index.Build(code.Bytes(), kBase, 1);
+
+		FILE* file = tmpfile();
+		CHECK(file && index.Save(file, 42));
+		if (!file) return;
+
+		XrefIndex loaded;
+		rewind(file);
+		CHECK(!loaded.Load(file, 41));
+
+		rewind(file);
+		CHECK(loaded.Load(file, 42));
+		CHECK(loaded.GetCallCount() == index.GetCallCount());
+		CHECK(loaded.GetReferenceCount() == index.GetReferenceCount());
+		CHECK(loaded.GetCallee(kBase + 0x20) == kBase + 0x100);
+		CHECK(SameEdges(loaded.GetCallersOf(kBase + 0x100), index.GetCallersOf(kBase + 0x100)));
+		CHECK(SameEdges(loaded.GetReferencesTo(kBase + 0x800), index.GetReferencesTo(kBase + 0x800)));
+
+		// Counts larger than the file must be rejected before anything is allocated
+		const uint64_t hugeCount = ~0ull / 2;
+		fseek(file, 16, SEEK_SET);	// CacheHeader::callCount
+		fwrite(&hugeCount, sizeof(hugeCount), 1, file);
+		rewind(file);
+		XrefIndex corrupt;
+		CHECK(!corrupt.Load(file, 42));
+		CHECK(corrupt.IsEmpty());
+		fclose(file);
+
+		// Truncated edge data
+		file = tmpfile();
+		CHECK(file && index.Save(file, 42));
+		if (!file) return;
+
+		std::vector<uint8_t> bytes(static_cast<size_t>(ftell(file)));
+		rewind(file);
+		CHECK(fread(bytes.data(), 1, bytes.size(), file) == bytes.size());
+		fclose(file);
+
+		file = tmpfile();
+		fwrite(bytes.data(), 1, bytes.size() - sizeof(XrefIndex::Edge), file);
+		rewind(file);
+		CHECK(!corrupt.Load(file, 42));
+		fclose(file);
+	}
+
+	void TestPattern()
+	{
+		const std::vector<uint8_t> data = { 0x90, 0x48, 0x83, 0xC4, 0x28, 0xC3 };
+
+		CHECK(Pattern::Find(data, "48 83 C4 ? C3") == 1u);
+		CHECK(Pattern::Find(data, "? 83") == 1u);
+		CHECK(!Pattern::Find(data, "48 83 C5"));
+	}
+}
+
+int main()
+{
+	TestLookups();
+	TestChunkResync();
+	TestSaveLoad();
+	TestPattern();
+
+	return ReportChecks();
+}
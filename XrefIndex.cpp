@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "XrefIndex.h"
+
+#include <Zydis/Zydis.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint64_t callCount;
+		uint64_t referenceCount;
+	};
+
+	constexpr char kMagic[4] = { 'D', 'S', 'X', 'I' };
+	constexpr uint32_t kVersion = 1;
+
+	// How far into a chunk to look for padding to resync the linear sweep on
+	constexpr size_t kResyncWindow = 4096;
+
+	bool ByFrom(const XrefIndex::Edge& a, const XrefIndex::Edge& b) { return a.from < b.from; }
+	bool ByTo(const XrefIndex::Edge& a, const XrefIndex::Edge& b) { return a.to != b.to ? a.to < b.to : a.from < b.from; }
+
+	// A chunk boundary can land inside an instruction. Compilers pad between functions with
+	// int3, so starting right after such a run puts the decoder on an instruction boundary.
+	size_t FindChunkStart(std::span<const uint8_t> code, size_t offset)
+	{
+		const size_t end = std::min(code.size(), offset + kResyncWindow);
+		for (size_t i = offset; i + 1 < end; ++i) {
+			if (code[i] == 0xCC && code[i + 1] == 0xCC) {
+				while (i < code.size() && code[i] == 0xCC) ++i;
+				return i;
+			}
+		}
+		return offset;
+	}
+
+	void DecodeRange(std::span<const uint8_t> code, uint32_t rva, size_t begin, size_t end,
+		std::vector<XrefIndex::Edge>& calls, std::vector<XrefIndex::Edge>& references)
+	{
+		ZydisDecoder decoder;
+		ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+		ZydisDecodedInstruction instruction;
+		size_t offset = begin;
+
+		while (offset < end) {
+			if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, ZYAN_NULL, code.data() + offset, code.size() - offset, &instruction))) {
+				offset++;
+				continue;
+			}
+
+			const auto from = static_cast<uint32_t>(rva + offset);
+			const int64_t next = static_cast<int64_t>(from) + instruction.length;
+
+			if (instruction.mnemonic == ZYDIS_MNEMONIC_CALL && instruction.raw.imm[0].is_relative) {
+				calls.push_back({ from, static_cast<uint32_t>(next + instruction.raw.imm[0].value.s) });
+			}
+			else if ((instruction.attributes & ZYDIS_ATTRIB_HAS_MODRM) &&
+				instruction.raw.modrm.mod == 0 && instruction.raw.modrm.rm == 5) {
+				// mod 00 rm 101 without SIB is [rip + disp32] in 64-bit mode
+				references.push_back({ from, static_cast<uint32_t>(next + instruction.raw.disp.value) });
+			}
+
+			offset += instruction.length;
+		}
+	}
+}
+
+void XrefIndex::Build(std::span<const uint8_t> code, uint32_t rva, unsigned threads)
+{
+	m_Calls.clear();
+	m_References.clear();
+
+	if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+
+	// Small buffers are not worth splitting
+	const size_t chunkSize = std::max<size_t>(code.size() / threads, 64 * 1024);
+	std::vector<size_t> starts{ 0 };
+	for (size_t offset = chunkSize; offset < code.size(); offset += chunkSize) {
+		const size_t start = FindChunkStart(code, offset);
+		if (start > starts.back() && start < code.size())
+			starts.push_back(start);
+	}
+	starts.push_back(code.size());
+
+	// Every worker decodes up to the next worker's start, so the ranges cover the code exactly once.
+	// The calling thread takes the first chunk, so a single thread build never starts a thread
+	const size_t workerCount = starts.size() - 1;
+	std::vector<std::vector<Edge>> calls(workerCount);
+	std::vector<std::vector<Edge>> references(workerCount);
+	std::vector<std::thread> workers;
+	workers.reserve(workerCount - 1);
+
+	for (size_t i = 1; i < workerCount; ++i) {
+		workers.emplace_back(DecodeRange, code, rva, starts[i], starts[i + 1], std::ref(calls[i]), std::ref(references[i]));
+	}
+	DecodeRange(code, rva, starts[0], starts[1], calls[0], references[0]);
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	size_t callCount = 0;
+	size_t referenceCount = 0;
+	for (size_t i = 0; i < workerCount; ++i) {
+		callCount += calls[i].size();
+		referenceCount += references[i].size();
+	}
+
+	// Chunks are in address order, so appending keeps m_Calls sorted by from
+	m_Calls.reserve(callCount);
+	m_References.reserve(referenceCount);
+	for (size_t i = 0; i < workerCount; ++i) {
+		m_Calls.insert(m_Calls.end(), calls[i].begin(), calls[i].end());
+		m_References.insert(m_References.end(), references[i].begin(), references[i].end());
+	}
+
+	std::sort(m_References.begin(), m_References.end(), ByTo);
+	Finalize();
+}
+
+void XrefIndex::Finalize()
+{
+	m_CallsByCallee = m_Calls;
+	std::sort(m_CallsByCallee.begin(), m_CallsByCallee.end(), ByTo);
+}
+
+uint32_t XrefIndex::GetCallee(uint32_t callSite) const
+{
+	const auto it = std::lower_bound(m_Calls.begin(), m_Calls.end(), Edge{ callSite, 0 }, ByFrom);
+	return (it != m_Calls.end() && it->from == callSite) ? it->to : 0;
+}
+
+uint32_t XrefIndex::GetNextCallee(uint32_t rva, uint32_t maxDistance) const
+{
+	const auto it = std::lower_bound(m_Calls.begin(), m_Calls.end(), Edge{ rva, 0 }, ByFrom);
+	return (it != m_Calls.end() && it->from - rva < maxDistance) ? it->to : 0;
+}
+
+std::span<const XrefIndex::Edge> XrefIndex::EqualRange(const std::vector<Edge>& edges, uint32_t target)
+{
+	const auto [first, last] = std::equal_range(edges.begin(), edges.end(), Edge{ 0, target },
+		[](const Edge& a, const Edge& b) { return a.to < b.to; });
+	return { edges.data() + (first - edges.begin()), static_cast<size_t>(last - first) };
+}
+
+std::span<const XrefIndex::Edge> XrefIndex::GetCallersOf(uint32_t callee) const
+{
+	return EqualRange(m_CallsByCallee, callee);
+}
+
+std::span<const XrefIndex::Edge> XrefIndex::GetReferencesTo(uint32_t target) const
+{
+	return EqualRange(m_References, target);
+}
+
+bool XrefIndex::Save(FILE* file, uint64_t key) const
+{
+	CacheHeader header{};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.key = key;
+	header.callCount = m_Calls.size();
+	header.referenceCount = m_References.size();
+
+	return fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(m_Calls.data(), sizeof(Edge), m_Calls.size(), file) == m_Calls.size() &&
+		fwrite(m_References.data(), sizeof(Edge), m_References.size(), file) == m_References.size();
+}
+
+bool XrefIndex::Load(FILE* file, uint64_t key)
+{
+	CacheHeader header{};
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+		memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+		header.version != kVersion ||
+		header.key != key) {
+		return false;
+	}
+
+	// A corrupt header must not size the vectors, the counts have to fit in the rest of the file
+	const long dataStart = ftell(file);
+	if (dataStart < 0 || fseek(file, 0, SEEK_END) != 0) return false;
+	const long fileEnd = ftell(file);
+	if (fileEnd < dataStart || fseek(file, dataStart, SEEK_SET) != 0) return false;
+
+	const uint64_t edgesInFile = static_cast<uint64_t>(fileEnd - dataStart) / sizeof(Edge);
+	if (header.callCount > edgesInFile || header.referenceCount > edgesInFile - header.callCount) return false;
+
+	m_Calls.resize(header.callCount);
+	m_References.resize(header.referenceCount);
+
+	// Lookups binary search, so unsorted edges mean the cache is damaged
+	if (fread(m_Calls.data(), sizeof(Edge), m_Calls.size(), file) != m_Calls.size() ||
+		fread(m_References.data(), sizeof(Edge), m_References.size(), file) != m_References.size() ||
+		!std::is_sorted(m_Calls.begin(), m_Calls.end(), ByFrom) ||
+		!std::is_sorted(m_References.begin(), m_References.end(), ByTo)) {
+		m_Calls.clear();
+		m_References.clear();
+		return false;
+	}
+
+	Finalize();
+	return true;
+}
+
+std::optional<size_t> Pattern::Find(std::span<const uint8_t> data, std::string_view pattern)
+{
+	std::vector<int> bytes;	// -1 is a wildcard
+
+	for (size_t pos = 0; pos < pattern.size();) {
+		if (pattern[pos] == ' ') { pos++; continue; }
+
+		const size_t end = std::min(pattern.find(' ', pos), pattern.size());
+		const std::string_view token = pattern.substr(pos, end - pos);
+		pos = end;
+
+		if (token == "?" || token == "??") {
+			bytes.push_back(-1);
+			continue;
+		}
+
+		char* parsedEnd = nullptr;
+		const std::string text(token);
+		const long value = strtol(text.c_str(), &parsedEnd, 16);
+		if (*parsedEnd || value < 0 || value > 0xFF) return std::nullopt;
+		bytes.push_back(static_cast<int>(value));
+	}
+
+	if (bytes.empty() || bytes.size() > data.size()) return std::nullopt;
+
+	// Anchor on the first fixed byte so memchr can skip ahead
+	const auto anchor = std::find_if(bytes.begin(), bytes.end(), [](int b) { return b >= 0; });
+	const size_t anchorIndex = anchor - bytes.begin();
+
+	for (size_t i = 0; i + bytes.size() <= data.size(); ++i) {
+		if (anchor != bytes.end()) {
+			const void* hit = memchr(data.data() + i + anchorIndex, *anchor, data.size() - bytes.size() - i + 1);
+			if (!hit) break;
+			i = static_cast<const uint8_t*>(hit) - data.data() - anchorIndex;
+		}
+
+		bool match = true;
+		for (size_t j = 0; j < bytes.size() && match; ++j)
+			match = bytes[j] < 0 || data[i + j] == bytes[j];
+
+		if (match) return i;
+	}
+
+	return std::nullopt;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Sorted index of the call edges and RIP-relative data references in a block of x64 code.
+// Built once with a parallel Zydis decode pass, so signatures can be written as
+// "callee of the call at pattern X" or "code referencing string Y" instead of long
+// prologue patterns. Works on any buffer, addresses are RVAs relative to the image base.
+class XrefIndex
+{
+public:
+	struct Edge
+	{
+		uint32_t from;	// Instruction RVA
+		uint32_t to;	// Call target or referenced data RVA
+	};
+
+	// `code` is mapped at `rva`. `threads` = 0 uses every core, 1 decodes on the calling thread only
+	void Build(std::span<const uint8_t> code, uint32_t rva, unsigned threads = 0);
+
+	// Callee of the call instruction starting at `callSite`, 0 if there is none
+	uint32_t GetCallee(uint32_t callSite) const;
+
+	// Callee of the first call starting in [rva, rva + maxDistance), 0 if there is none
+	uint32_t GetNextCallee(uint32_t rva, uint32_t maxDistance = 64) const;
+
+	// Sorted by instruction RVA
+	std::span<const Edge> GetCallersOf(uint32_t callee) const;
+	std::span<const Edge> GetReferencesTo(uint32_t target) const;
+
+	size_t GetCallCount() const { return m_Calls.size(); }
+	size_t GetReferenceCount() const { return m_References.size(); }
+	bool IsEmpty() const { return m_Calls.empty() && m_References.empty(); }
+
+	// `key` identifies the decoded code; Load fails if the cached index was built for other code
+	bool Save(FILE* file, uint64_t key) const;
+	bool Load(FILE* file, uint64_t key);
+
+private:
+	static std::span<const Edge> EqualRange(const std::vector<Edge>& edges, uint32_t target);
+	void Finalize();
+
+	std::vector<Edge> m_Calls;			// Sorted by from
+	std::vector<Edge> m_CallsByCallee;	// Sorted by to, then from
+	std::vector<Edge> m_References;		// Sorted by to, then from
+};
+
+namespace Pattern
+{
+	// IDA style pattern, e.g. "E8 ? ? ? ? 48 83 C4". Returns the offset of the first match
+	std::optional<size_t> Find(std::span<const uint8_t> data, std::string_view pattern);
+}
@@ -4,6 +4,7 @@
 #include <Psapi.h>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 
 #include <Xinput.h>
@@ -13,11 +14,24 @@
 #include "PluginAPI.h"
 
 #include "Actor.h"
+#include "ActorSpellCleanup.h"
 #include "BaseProcess.h"
+#include "Commands.h"
 #include "ConfigFile.h"
+#include "DeletionJournal.h"
+#include "DeletionScheduler.h"
+#include "MagicCaster.h"
 #include "MagicMenu.h"
+#include "MagicTarget.h"
+#include "ModuleXrefs.h"
 #include "PlayerCharacter.h"
+#include "PruneRules.h"
+#include "SpellAccess.h"
+#include "SpellDuplicates.h"
+#include "SpellExport.h"
 #include "SpellItem.h"
+#include "SpellProfiler.h"
+#include "SpellStats.h"
 #include "Tile.h"
 
 #include "Utils/Hooklib.h"
@@ -41,6 +55,8 @@ using FnMagicMenu_UpdateList	= void(__fastcall*)();
 using FnGetMessageMenuResult	= int64_t(__fastcall*)();
 using FnInterfaceMessageMenu	= bool(__fastcall*)(const char*, void(__fastcall*)(), int, const char*, ...);
 using FnMagicMenu_DoClick		= void(__fastcall*)(MagicMenu*, int, Tile*);
+using FnMagicCaster_CastSpell	= bool(__fastcall*)(MagicCaster*, SpellItem*, bool, MagicTarget*, float, bool);
+using FnActor_AddSpell			= bool(__fastcall*)(Actor*, SpellItem*);
 
 // Function pointers
 static FnGetMenuByClass			GetMenuByClass;
@@ -49,12 +65,15 @@ static FnMagicMenu_UpdateList	MagicMenu_UpdateList;
 static FnGetMessageMenuResult	GetMessageMenuresult;
 static FnInterfaceMessageMenu	Interface_CreateMessageMenu;
 static FnMagicMenu_DoClick		og_MagicMenu_DoClick;
+static FnMagicCaster_CastSpell	og_MagicCaster_CastSpell;
+static FnActor_AddSpell			og_Actor_AddSpell;
 
 // Config flags
 static bool protectSpells = ConfigFile::GetBool("bProtectSpells", true);
 static bool translationFile = ConfigFile::GetBool("bUseTranslationFile", true);
 static bool spellInfoLog = ConfigFile::GetBool("bSpellInfoLog", false);
 static bool gamepadSupport = ConfigFile::GetBool("bGamepadSupport", true);
+static bool useXrefIndex = ConfigFile::GetBool("bUseXrefIndex", false);
 
 // Keyboard keys
 static int keyboardModifierKey = ConfigFile::GetInt("iKeyboardModifierKey", VK_LSHIFT);
@@ -63,9 +82,44 @@ static int keyboardModifierKey = ConfigFile::GetInt("iKeyboardModifierKey", VK_L
 static int gamepadDeleteButton = ConfigFile::GetInt("iGamepadDeleteButton", 0x1000); // XINPUT_GAMEPAD_A (PSCross, Xbox A)
 static int gamepadModifierButton = ConfigFile::GetInt("iGamepadModifierButton", 0x0020); // XINPUT_GAMEPAD_BACK (PSSelect, Xbox Back)
 
+// Deletion journal
+static bool deletionJournal = ConfigFile::GetBool("bDeletionJournal", true);
+static int undoCount = ConfigFile::GetInt("iUndoCount", 1);
+
+// Spell usage tracking
+static int unusedSpellHours = ConfigFile::GetInt("iUnusedSpellHours", 20);
+static uint8_t unusedSpellTypes = 0;	// Bit per spell type, set in Init from sUnusedSpellTypes
+
+// Profiler
+static int profileTopSpells = ConfigFile::GetInt("iProfileTopSpells", 20);
+
+// Optional hook signatures, not shipped until verified against the current runtime (empty disables the feature)
+static const std::string castSpellSignature = ConfigFile::GetString("sCastSpellSignature");
+static const std::string addSpellSignature = ConfigFile::GetString("sAddSpellSignature");
+
 // Blacklisted FormIDs
 static const auto& ignoredSpells = ConfigFile::GetBlacklistedSpells();
 
+// Blacklisted spells are never deleted, whichever path requested the deletion
+static bool IsSpellProtected(const SpellItem* spell) {
+	return protectSpells && ignoredSpells.contains(spell->iFormID);
+}
+
+// Set by the profiler command, the rebuild is timed right after the game's next own rebuild
+static bool profileRebuildPending = false;
+
+// Set while undo re-adds spells, so the auto prune rules do not reject them again
+static bool restoringSpells = false;
+
+// Auto prune
+static PruneRules autoPruneRules;
+static uint32_t autoPruneQueue[256];
+static size_t autoPruneQueued = 0;
+
+// Actor cleanup
+static PruneRules actorRemovalRules;
+static bool actorCleanupIncludePlayer = ConfigFile::GetBool("bActorCleanupIncludePlayer", false);
+
 // Returns the state of the active gamepad, or an error code if none is connected
 static DWORD GetActiveGamepadState(XINPUT_STATE& outState) {
 	static int activeGamepad = -1;
@@ -151,7 +205,235 @@ static bool IsKeyboardDeleteComboPressed() {
 	return IsModifierKeyHeld() && !IsAnyNonModifierKeyHeld();
 }
 
+// Removes a spell from the player and journals it so it can be undone
+static bool DeleteSpell(SpellItem* spell) {
+	if (!PlayerCharacter::GetSingleton()->RemoveSpell(spell))
+		return false;
+
+	DeletionJournal::RecordDeletion(spell->iFormID);
+	return true;
+}
+
+// Deletion scheduler callback. IDs are resolved again since the spell may be gone by now
+static bool DeleteSpellByID(uint32_t formID) {
+	SpellItem* spell = SpellAccess::LookupSpell(formID);
+	if (!spell) return false;
+
+	if (IsSpellProtected(spell)) {
+		printf("[Delete Spells] Skipping deletion for blacklisted spell: %08X\n", formID);
+		return false;
+	}
+
+	return DeleteSpell(spell);
+}
+
+// Re-adds the last N deleted spells from the journal. N is the message argument when another
+// plugin sends the command with one, iUndoCount otherwise
+static void UndoDeletions() {
+	const uint32_t requested = Commands::GetArgument(Command::UndoDeletions);
+	const size_t count = requested ? requested : static_cast<size_t>(std::max(undoCount, 1));
+
+	int restored = 0;
+	std::vector<uint32_t> failed;
+
+	// Only deletions that are really back are journaled as restored, the rest stay undoable
+	restoringSpells = true;
+	for (const uint32_t formID : DeletionJournal::TakeUndo(count)) {
+		SpellItem* spell = SpellAccess::LookupSpell(formID);
+		if (!spell) {
+			printf("[Delete Spells] Cannot undo deletion of %08X, spell no longer exists\n", formID);
+			failed.push_back(formID);
+			continue;
+		}
+
+		if (!PlayerCharacter::GetSingleton()->AddSpell(spell)) {
+			printf("[Delete Spells] Cannot undo deletion of %08X, the spell could not be added\n", formID);
+			failed.push_back(formID);
+			continue;
+		}
+
+		DeletionJournal::RecordRestore(formID);
+		restored++;
+	}
+	restoringSpells = false;
+
+	DeletionJournal::ReturnUndo(failed);
+
+	printf("[Delete Spells] Restored %d spells (%zu failed), %zu deletions can be undone\n",
+		restored,
+		failed.size(),
+		DeletionJournal::GetUndoableCount()
+	);
+}
+
+// Queues every spell of sUnusedSpellTypes the player has not cast for iUnusedSpellHours hours of play.
+// Abilities and diseases are never cast, so they are left out by default
+static void CleanupUnusedSpells() {
+	if (!SpellStats::IsEnabled()) {
+		printf("[Delete Spells] Spell usage tracking is disabled (sCastSpellSignature not set), nothing to clean up\n");
+		return;
+	}
+
+	std::vector<uint32_t> formIDs;
+	int skipped = 0;
+
+	for (SpellItem* spell : SpellAccess::CollectPlayerSpells()) {
+		const int type = spell->data.iSpellType;
+		if (type < 0 || type > 7 || !(unusedSpellTypes & (1u << type)))
+			continue;
+
+		if (!SpellStats::IsUnusedFor(spell->iFormID, unusedSpellHours))
+			continue;
+
+		if (IsSpellProtected(spell)) {
+			skipped++;
+			continue;
+		}
+
+		formIDs.push_back(spell->iFormID);
+	}
+
+	DeletionScheduler::Enqueue(formIDs);
+	printf("[Delete Spells] Queued %zu spells unused for %d hours of play (%d blacklisted spells kept)\n", formIDs.size(), unusedSpellHours, skipped);
+}
+
+// Queues every spell whose effects duplicate another spell, keeping one per group.
+// Only spells made at a spellmaking altar (mod index 0xFF) are candidates, so abilities, diseases
+// and mod spells that happen to share effects are never touched
+static void DeleteDuplicateSpells() {
+	const auto start = std::chrono::steady_clock::now();
+	auto candidates = SpellAccess::CollectPlayerSpells();
+	std::erase_if(candidates, [](const SpellItem* spell) { return (spell->iFormID >> 24) != 0xFF; });
+	const auto groups = SpellDuplicates::Find(candidates);
+	const auto found = std::chrono::steady_clock::now();
+
+	std::vector<uint32_t> formIDs;
+	int skipped = 0;
+
+	for (const auto& group : groups) {
+		if (spellInfoLog) {
+			printf("[Delete Spells] Duplicate group of %zu, keeping %08X\n", group.spells.size(), group.spells.front()->iFormID);
+		}
+
+		for (size_t i = 1; i < group.spells.size(); ++i) {
+			SpellItem* spell = group.spells[i];
+			if (IsSpellProtected(spell)) {
+				skipped++;
+				continue;
+			}
+
+			formIDs.push_back(spell->iFormID);
+		}
+	}
+
+	DeletionScheduler::Enqueue(formIDs);
+	printf("[Delete Spells] Queued %zu duplicate spells in %zu groups of %zu created spells (%d blacklisted spells kept) | find %.2f ms\n",
+		formIDs.size(),
+		groups.size(),
+		candidates.size(),
+		skipped,
+		std::chrono::duration<double, std::milli>(found - start).count()
+	);
+}
+
+// Hands the spells the auto prune rules let through with action=queue to the scheduler
+static void ApplyAutoPrune() {
+	DeletionScheduler::Enqueue({ autoPruneQueue, autoPruneQueued });
+	printf("[Delete Spells] Auto prune queued %zu spells\n", autoPruneQueued);
+	autoPruneQueued = 0;
+}
+
+// Removes spells matching ActorRemovalRules from every loaded actor
+static void RemoveActorSpells() {
+	if (actorRemovalRules.IsEmpty()) {
+		printf("[Delete Spells] No ActorRemovalRules configured\n");
+		return;
+	}
+
+	const auto report = ActorSpellCleanup::Run(actorRemovalRules, ignoredSpells, actorCleanupIncludePlayer, DeleteSpell);
+
+	printf("[Delete Spells] Actor cleanup: %zu actors, %zu spells scanned, %zu candidates, %zu removed, %zu blacklisted kept\n",
+		report.actors,
+		report.spellsScanned,
+		report.candidates,
+		report.removed,
+		report.blacklisted
+	);
+	printf("[Delete Spells] Actor cleanup timings: snapshot %.3f ms | scan %.3f ms | apply %.3f ms\n",
+		report.snapshotMs,
+		report.scanMs,
+		report.applyMs
+	);
+}
+
 // Hooks
+
+// Only installed from a user supplied sAddSpellSignature. The prototype is assumed, not verified
+// against the runtime, so the signature must point at a function taking (Actor*, SpellItem*) and returning bool
+static bool hk_Actor_AddSpell(Actor* actor, SpellItem* spell) {
+	// The blacklist always wins over the rules, even when bProtectSpells is off
+	if (restoringSpells || !spell || actor != PlayerCharacter::GetSingleton() || ignoredSpells.contains(spell->iFormID))
+		return og_Actor_AddSpell(actor, spell);
+
+	const auto action = autoPruneRules.Match(spell->iFormID, spell->data.iSpellType, spell->data.flags);
+
+	if (action == PruneRules::Action::Reject) {
+		if (spellInfoLog) {
+			printf("[Delete Spells] Auto prune rejected spell: %08X\n", spell->iFormID);
+		}
+		return false;
+	}
+
+	if (!og_Actor_AddSpell(actor, spell))
+		return false;
+
+	if (action == PruneRules::Action::Queue) {
+		if (autoPruneQueued < std::size(autoPruneQueue)) {
+			autoPruneQueue[autoPruneQueued++] = spell->iFormID;
+			Commands::Queue(Command::ApplyAutoPrune);
+		}
+		else {
+			printf("[Delete Spells] Auto prune queue full, keeping spell: %08X\n", spell->iFormID);
+		}
+	}
+
+	return true;
+}
+
+static bool hk_MagicCaster_CastSpell(MagicCaster* caster, SpellItem* spell, bool noHitEffect, MagicTarget* target, float effectiveness, bool hostileOnly) {
+	if (spell && caster == static_cast<MagicCaster*>(PlayerCharacter::GetSingleton())) {
+		SpellStats::RecordCast(spell->iFormID);
+	}
+
+	return og_MagicCaster_CastSpell(caster, spell, noHitEffect, target, effectiveness, hostileOnly);
+}
+
+// Commands run inside hk_MagicMenu_UpdateList, so the rebuild is timed once the game's own rebuild has returned
+static void ProfileSpells() {
+	SpellProfiler::Run(static_cast<size_t>(std::max(profileTopSpells, 0)));
+	profileRebuildPending = true;
+}
+
+// Called right after the game rebuilt the list itself, so the menu is open and rebuilding it again is expected
+static void TimePendingRebuild() {
+	if (!profileRebuildPending) return;
+	profileRebuildPending = false;
+
+	SpellProfiler::TimeRebuild(MagicMenu_UpdateList);
+}
+
+// The list rebuild runs on the game thread whenever the Magic menu opens or refreshes,
+// which makes it a safe point for queued commands and deletions. The rebuild itself
+// follows, so the drain does not refresh the menu again.
+static void hk_MagicMenu_UpdateList() {
+	Commands::RunPending();
+	DeletionScheduler::Drain();
+	MagicMenu_UpdateList();
+
+	// After the game's rebuild has returned, so the timed rebuilds do not nest in it
+	TimePendingRebuild();
+}
+
 static void hk_MagicMenu_DoClick(MagicMenu* menu, int aiID, Tile* apTarget) {
 	// Skip if menu not visible or if confirmation dialog is open
 	if (!menu->IsVisible || GetMenuByClass(1016)) {
@@ -212,24 +494,37 @@ static void hk_MagicMenu_DoClick(MagicMenu* menu, int aiID, Tile* apTarget) {
 			data.iCostOverride,
 			data.flags
 		);
+
+		if (SpellStats::IsEnabled()) {
+			if (const auto usage = SpellStats::Get(curItem->iFormID)) {
+				printf("[Delete Spells] Cast %u times, last used %lld hours of play ago\n",
+					usage->castCount,
+					static_cast<long long>((SpellStats::Now() - usage->lastUsed) / 3600)
+				);
+			}
+			else {
+				printf("[Delete Spells] Not cast since tracking started\n");
+			}
+		}
 	}
 
 	// Check if the spell is protected or blacklisted
-	if (protectSpells && ignoredSpells.contains(curItem->iFormID)) {
+	if (IsSpellProtected(curItem)) {
 		printf("[Delete Spells] Skipping deletion for blacklisted spell: %08X\n", curItem->iFormID);
 		og_MagicMenu_DoClick(menu, aiID, apTarget);
 		return;
 	}
 
-	// Confirmation dialog
-	static SpellItem* selectedItem = nullptr;
-	selectedItem = curItem;
+	// Confirmation dialog. The FormID is kept rather than the pointer and resolved again on confirm.
+	// The confirmed spell is deleted right away instead of waiting behind queued batches
+	static uint32_t selectedFormID = 0;
+	selectedFormID = curItem->iFormID;
 
 	Interface_CreateMessageMenu(
 		translationFile ? "LOC_HC_DeleteSpell_Confirm" : "Are you sure you want to delete this spell?",
 		[] {
 			if (GetMessageMenuresult() == 1) {
-				PlayerCharacter::GetSingleton()->RemoveSpell(selectedItem);
+				DeleteSpellByID(selectedFormID);
 				MagicMenu_UpdateList();
 			}
 		},
@@ -241,7 +536,7 @@ static void hk_MagicMenu_DoClick(MagicMenu* menu, int aiID, Tile* apTarget) {
 }
 
 
-static bool Init() {
+static bool Init(const OBSEInterface* obse) {
 #ifdef DEBUG
 	AllocConsole();
 	(void)freopen_s(reinterpret_cast<FILE**>(stdout), "CONOUT$", "w", stdout);
@@ -249,17 +544,75 @@ static bool Init() {
 	HookLib::Init();
 	Signatures::Init();
 
+	// Commands
+	Commands::Register(Command::CleanupUnusedSpells, "CleanupUnusedSpells", "iCleanupUnusedKey", CleanupUnusedSpells);
+	Commands::Register(Command::DeleteDuplicateSpells, "DeleteDuplicateSpells", "iDeleteDuplicatesKey", DeleteDuplicateSpells);
+	Commands::Register(Command::ApplyAutoPrune, "ApplyAutoPrune", nullptr, ApplyAutoPrune);
+	Commands::Register(Command::UndoDeletions, "UndoDeletions", "iUndoKey", UndoDeletions);
+	Commands::Register(Command::ExportSpells, "ExportSpells", "iExportKey", SpellExport::Run);
+	Commands::Register(Command::RemoveActorSpells, "RemoveActorSpells", "iActorCleanupKey", RemoveActorSpells);
+	Commands::Register(Command::CancelDeletions, "CancelDeletions", "iCancelDeletionsKey", DeletionScheduler::Cancel);
+	Commands::Register(Command::ProfileSpells, "ProfileSpells", "iProfileKey", ProfileSpells);
+
+	OBSEMessagingInterface* messaging = nullptr;
+	PluginHandle pluginHandle = kPluginHandle_Invalid;
+	if (obse) {
+		pluginHandle = obse->GetPluginHandle();
+		messaging = static_cast<OBSEMessagingInterface*>(obse->QueryInterface(kInterface_Messaging));
+	}
+	Commands::Init(messaging, pluginHandle);
+
+	if (deletionJournal) {
+		DeletionJournal::Init();
+	}
+
 	printf("[Delete Spells] Initializing pointers\n");
 	Scanner::Add("8D 81 ? ? ? ? 83 F8 ? 77 ? 0F B7 05", &GetMenuByClass);
 	Scanner::Add("4C 8B 41 ? 4D 85 C0 74 ? 0F 1F 80 ? ? ? ? 49 8B 48 ? 49 8D 40 ? ? ? ? 0F B7 41 ? 3B C2 74 ? 7F ? 4D 85 C0 75 ? 0F 57 C0", &TileGetFloat);
-	Scanner::Add("48 8B C4 48 89 58 ? 48 89 70 ? 48 89 78 ? 55 41 54 41 55 41 56 41 57 48 8D A8 ? ? ? ? 48 81 EC ? ? ? ? 0F 29 70 ? 0F 29 78 ? 48 8B 05 ? ? ? ? 48 33 C4 48 89 85 ? ? ? ? B9", &MagicMenu_UpdateList);
-	Scanner::Add({ "E8 ? ? ? ? 48 83 C4 ? 5F C3 33 D2", 1, 4 }, &Interface_CreateMessageMenu);
+	Scanner::AddPrologueHook("48 8B C4 48 89 58 ? 48 89 70 ? 48 89 78 ? 55 41 54 41 55 41 56 41 57 48 8D A8 ? ? ? ? 48 81 EC ? ? ? ? 0F 29 70 ? 0F 29 78 ? 48 8B 05 ? ? ? ? 48 33 C4 48 89 85 ? ? ? ? B9", hk_MagicMenu_UpdateList, &MagicMenu_UpdateList);
+
+	// Resolved from the decoded call instead of reading the rel32 bytes by hand.
+	// The ASI build runs this in DllMain under the loader lock, where joining a new thread deadlocks,
+	// so the index is built on the calling thread there
+	if (useXrefIndex && ModuleXrefs::Init(obse ? 0 : 1)) {
+		Interface_CreateMessageMenu = reinterpret_cast<FnInterfaceMessageMenu>(ModuleXrefs::ResolveCallAfter("E8 ? ? ? ? 48 83 C4 ? 5F C3 33 D2"));
+	}
+	if (!Interface_CreateMessageMenu) {
+		Scanner::Add({ "E8 ? ? ? ? 48 83 C4 ? 5F C3 33 D2", 1, 4 }, &Interface_CreateMessageMenu);
+	}
 	Scanner::Add("40 53 48 83 EC ? B2 ? 33 C9 E8 ? ? ? ? B2", &GetMessageMenuresult);
 	Scanner::AddPrologueHook("48 89 5C 24 ? 48 89 6C 24 ? 48 89 74 24 ? 57 41 56 41 57 48 83 EC ? 4C 8B F1 4C 89 64 24", hk_MagicMenu_DoClick, &og_MagicMenu_DoClick);
 
+	if (!castSpellSignature.empty()) {
+		const std::string types = ConfigFile::GetString("sUnusedSpellTypes", "spell|power|lesserpower");
+		if (!PruneRules::ParseSpellTypes(types, unusedSpellTypes)) {
+			printf("[Delete Spells] Invalid sUnusedSpellTypes: %s, using spell|power|lesserpower\n", types.c_str());
+			PruneRules::ParseSpellTypes("spell|power|lesserpower", unusedSpellTypes);
+		}
+
+		SpellStats::Init();
+		Scanner::AddPrologueHook(castSpellSignature.c_str(), hk_MagicCaster_CastSpell, &og_MagicCaster_CastSpell);
+	}
+	else {
+		printf("[Delete Spells] sCastSpellSignature not set, spell usage tracking and CleanupUnusedSpells disabled\n");
+	}
+
+	autoPruneRules.Compile(ConfigFile::GetArray("AutoPruneRules"));
+	if (!autoPruneRules.IsEmpty() && !addSpellSignature.empty()) {
+		printf("[Delete Spells] Auto prune enabled with %zu rules\n", autoPruneRules.GetRuleCount());
+		Scanner::AddPrologueHook(addSpellSignature.c_str(), hk_Actor_AddSpell, &og_Actor_AddSpell);
+	}
+	else if (!autoPruneRules.IsEmpty()) {
+		printf("[Delete Spells] sAddSpellSignature not set, the %zu AutoPruneRules are ignored\n", autoPruneRules.GetRuleCount());
+	}
+
+	actorRemovalRules.Compile(ConfigFile::GetArray("ActorRemovalRules"));
+
 	printf("[Delete Spells] Scanning pointers\n");
 	Scanner::Scan();
 
+	DeletionScheduler::Init(DeleteSpellByID);
+
 	printf("[Delete Spells] DeleteSpells loaded!\n");
 
 	return true;
@@ -269,7 +622,7 @@ static bool Init() {
 #ifdef ASI
 BOOL WINAPI DllMain(const HINSTANCE hinstDLL, const DWORD fdwReason, LPVOID) {
 	if (fdwReason == DLL_PROCESS_ATTACH) {
-		return Init();
+		return Init(nullptr);
 	}
 
 	return TRUE;
@@ -286,8 +639,8 @@ extern "C" {
 		0, 0, 0 // set these reserved fields to 0
 	};
 
-	__declspec(dllexport) bool OBSEPlugin_Load(const OBSEInterface*) {
-		return Init();
+	__declspec(dllexport) bool OBSEPlugin_Load(const OBSEInterface* obse) {
+		return Init(obse);
 	}
 };
 #endif
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+// The offline tools build the portable sources on other platforms
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files
 #include <windows.h>
+#endif